@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __AUDIOALLOCATOR_HPP__
+#define __AUDIOALLOCATOR_HPP__
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace asu {
+
+// every block handed out by an AudioAllocator starts on a cache line
+#define ASU_AUDIO_ALIGNMENT 64
+
+inline void* alignedAllocate(size_t bytes) {
+  void* ptr = nullptr;
+  #ifdef _WIN32
+  ptr = _aligned_malloc(bytes, ASU_AUDIO_ALIGNMENT);
+  #else
+  if (posix_memalign(&ptr, ASU_AUDIO_ALIGNMENT, bytes) != 0) {
+    ptr = nullptr;
+  }
+  #endif
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+inline void alignedFree(void* ptr) {
+  #ifdef _WIN32
+  _aligned_free(ptr);
+  #else
+  free(ptr);
+  #endif
+}
+
+/**
+ * Where AudioBufferC gets its memory from. deallocate is always called with
+ * the same size that was passed to allocate. The default allocator is used
+ * by the buffers that are not given one explicitly.
+ */
+class AudioAllocator {
+public:
+  virtual ~AudioAllocator() {}
+
+  virtual void* allocate(size_t bytes) = 0;
+  virtual void deallocate(void* ptr, size_t bytes) = 0;
+
+  // how many bytes a request for bytes really gets, buffers use the slack as
+  // capacity to grow without reallocating
+  virtual size_t getGoodSize(size_t bytes) const { return bytes; }
+
+  static AudioAllocator* getDefault();
+  static void setDefault(AudioAllocator* allocator);
+};
+
+// plain aligned heap allocation
+class HeapAudioAllocator : public AudioAllocator {
+public:
+  void* allocate(size_t bytes) {
+    return alignedAllocate(bytes);
+  }
+
+  void deallocate(void* ptr, size_t bytes) {
+    alignedFree(ptr);
+  }
+
+  static HeapAudioAllocator& instance() {
+    static HeapAudioAllocator allocator;
+    return allocator;
+  }
+};
+
+/**
+ * Blocks are rounded up to a power of two and recycled through one free
+ * list per size. Each thread keeps a few blocks of every size below
+ * THREAD_CACHE_MAX_BYTES for itself, so that steady state processing never
+ * takes a lock nor calls malloc. Memory is only given back to the system by
+ * trim. Blocks larger than the biggest size class bypass the pool.
+ */
+class PooledAudioAllocator : public AudioAllocator {
+public:
+  enum {
+    MIN_CLASS_SHIFT = 6,
+    MAX_CLASS_SHIFT = 28,
+    NUMBER_OF_CLASSES = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1,
+    THREAD_CACHE_BLOCKS = 8,
+    THREAD_CACHE_MAX_BYTES = 1 << 20
+  };
+
+  static PooledAudioAllocator& instance() {
+    static PooledAudioAllocator allocator;
+    return allocator;
+  }
+
+  void* allocate(size_t bytes) {
+    int sizeClass = getSizeClass(bytes);
+    if (sizeClass < 0) {
+      return alignedAllocate(bytes);
+    }
+    ThreadCache& cache = threadCache();
+    if (cache.counts[sizeClass] > 0) {
+      return cache.blocks[sizeClass][--cache.counts[sizeClass]];
+    }
+    FreeList& list = m_lists[sizeClass];
+    {
+      std::lock_guard<std::mutex> lock(list.mutex);
+      if (!list.blocks.empty()) {
+        void* block = list.blocks.back();
+        list.blocks.pop_back();
+        m_cachedBytes -= getClassSize(sizeClass);
+        return block;
+      }
+    }
+    return alignedAllocate(getClassSize(sizeClass));
+  }
+
+  void deallocate(void* ptr, size_t bytes) {
+    if (ptr == nullptr) {
+      return;
+    }
+    int sizeClass = getSizeClass(bytes);
+    if (sizeClass < 0) {
+      alignedFree(ptr);
+      return;
+    }
+    ThreadCache& cache = threadCache();
+    if (getClassSize(sizeClass) <= THREAD_CACHE_MAX_BYTES &&
+        cache.counts[sizeClass] < THREAD_CACHE_BLOCKS) {
+      cache.blocks[sizeClass][cache.counts[sizeClass]++] = ptr;
+      return;
+    }
+    giveBack(sizeClass, ptr);
+  }
+
+  size_t getGoodSize(size_t bytes) const {
+    int sizeClass = getSizeClass(bytes);
+    return sizeClass < 0 ? bytes : getClassSize(sizeClass);
+  }
+
+  // frees the blocks in the shared lists, the ones cached by the threads are
+  // kept until the threads exit
+  void trim() {
+    for (int i = 0; i < NUMBER_OF_CLASSES; ++i) {
+      std::lock_guard<std::mutex> lock(m_lists[i].mutex);
+      for (size_t b = 0; b < m_lists[i].blocks.size(); ++b) {
+        alignedFree(m_lists[i].blocks[b]);
+      }
+      m_cachedBytes -= m_lists[i].blocks.size() * getClassSize(i);
+      m_lists[i].blocks.clear();
+    }
+  }
+
+  // bytes waiting in the shared lists
+  size_t getCachedBytes() const {
+    return m_cachedBytes;
+  }
+
+  ~PooledAudioAllocator() {
+    trim();
+  }
+
+private:
+  PooledAudioAllocator() : m_cachedBytes(0) {}
+  PooledAudioAllocator(const PooledAudioAllocator&);
+  PooledAudioAllocator& operator=(const PooledAudioAllocator&);
+
+  struct FreeList {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+  };
+
+  struct ThreadCache {
+    ThreadCache() {
+      for (int i = 0; i < NUMBER_OF_CLASSES; ++i) counts[i] = 0;
+    }
+    // the blocks of a thread that exits go back to the shared lists
+    ~ThreadCache() {
+      PooledAudioAllocator& pool = instance();
+      for (int i = 0; i < NUMBER_OF_CLASSES; ++i) {
+        while (counts[i] > 0) {
+          pool.giveBack(i, blocks[i][--counts[i]]);
+        }
+      }
+    }
+    void* blocks[NUMBER_OF_CLASSES][THREAD_CACHE_BLOCKS];
+    int counts[NUMBER_OF_CLASSES];
+  };
+
+  static ThreadCache& threadCache() {
+    static thread_local ThreadCache cache;
+    return cache;
+  }
+
+  static int getSizeClass(size_t bytes) {
+    int shift = MIN_CLASS_SHIFT;
+    while (((size_t)1 << shift) < bytes) {
+      if (++shift > MAX_CLASS_SHIFT) {
+        return -1;
+      }
+    }
+    return shift - MIN_CLASS_SHIFT;
+  }
+
+  static size_t getClassSize(int sizeClass) {
+    return (size_t)1 << (sizeClass + MIN_CLASS_SHIFT);
+  }
+
+  void giveBack(int sizeClass, void* ptr) {
+    std::lock_guard<std::mutex> lock(m_lists[sizeClass].mutex);
+    m_lists[sizeClass].blocks.push_back(ptr);
+    m_cachedBytes += getClassSize(sizeClass);
+  }
+
+  FreeList m_lists[NUMBER_OF_CLASSES];
+  std::atomic<size_t> m_cachedBytes;
+};
+
+namespace detail {
+inline std::atomic<AudioAllocator*>& defaultAudioAllocator() {
+  static std::atomic<AudioAllocator*> allocator(&HeapAudioAllocator::instance());
+  return allocator;
+}
+}
+
+inline AudioAllocator* AudioAllocator::getDefault() {
+  return detail::defaultAudioAllocator().load();
+}
+
+// buffers keep the allocator they were created with, changing the default
+// only affects the new ones
+inline void AudioAllocator::setDefault(AudioAllocator* allocator) {
+  detail::defaultAudioAllocator().store(allocator ? allocator : &HeapAudioAllocator::instance());
+}
+
+}
+
+#endif // __AUDIOALLOCATOR_HPP__
@@ -44,53 +44,135 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <random>
 #include <memory>
+#include <vector>
 #include "MathUtilities.h"
+#include "VectorKernels.h"
+#include "MixingMatrix.hpp"
+#include "Convolution.hpp"
+#include "Resampler.hpp"
+#include "Oscillator.hpp"
+#include "Noise.hpp"
+#include "AudioAllocator.hpp"
+#include "AudioBufferView.hpp"
+#include "SampleConversion.h"
 
-#ifdef USE_SAMPLERATE
-#include "samplerate.h"
-#endif
 
 namespace asu {
 
+// how the channels are placed in the storage of an AudioBufferC
+enum AudioBufferLayout {
+  ASU_LAYOUT_PACKED,  // back to back, channel i starts at i * size
+  ASU_LAYOUT_ALIGNED  // every channel starts on its own cache line
+};
 
 template <class FTYPE>
 struct AudioBufferC {
 public:
-  AudioBufferC() :
+  // a null allocator means AudioAllocator::getDefault()
+  explicit AudioBufferC(AudioAllocator* allocator_ = nullptr) :
     channels(0),
     usedChannels(0),
     size(0),
     usedSize(0),
     data(NULL),
-    isSilent(true),
-    storage(NULL) {
+    storage(NULL),
+    storageCapacity(0),
+    pointerCapacity(0),
+    allocator(allocator_ ? allocator_ : AudioAllocator::getDefault()),
+    layout(ASU_LAYOUT_PACKED),
+    tailPadding(0),
+    stride(0) {
+
+  }
 
+	AudioBufferC(size_t nchan_, size_t size_, AudioAllocator* allocator_ = nullptr) :
+    channels(0),
+    usedChannels(0),
+    size(0),
+    usedSize(0),
+    data(NULL),
+    storage(NULL),
+    storageCapacity(0),
+    pointerCapacity(0),
+    allocator(allocator_ ? allocator_ : AudioAllocator::getDefault()),
+    layout(ASU_LAYOUT_PACKED),
+    tailPadding(0),
+    stride(0) {
+    resize(nchan_, size_);
   }
 
-	AudioBufferC(size_t nchan_, size_t size_) :
+  AudioBufferC(size_t nchan_, size_t size_, AudioBufferLayout layout_, size_t tailPadding_ = 0, AudioAllocator* allocator_ = nullptr) :
     channels(0),
     usedChannels(0),
     size(0),
     usedSize(0),
     data(NULL),
-    isSilent(true),
-    storage(NULL) {
+    storage(NULL),
+    storageCapacity(0),
+    pointerCapacity(0),
+    allocator(allocator_ ? allocator_ : AudioAllocator::getDefault()),
+    layout(layout_),
+    tailPadding(tailPadding_),
+    stride(0) {
     resize(nchan_, size_);
   }
 
 	~AudioBufferC() {
-    if (usedChannels && size) {
-      delete [] data;
-      delete [] storage;
+    release();
+  }
+
+  // takes the memory of rhs, that is left empty
+  AudioBufferC(AudioBufferC&& rhs) :
+    channels(0),
+    usedChannels(0),
+    size(0),
+    usedSize(0),
+    data(NULL),
+    storage(NULL),
+    storageCapacity(0),
+    pointerCapacity(0),
+    allocator(rhs.allocator),
+    layout(ASU_LAYOUT_PACKED),
+    tailPadding(0),
+    stride(0) {
+    steal(rhs);
+  }
+
+  AudioBufferC& operator=(AudioBufferC&& rhs) {
+    if (this != &rhs) {
+      release();
+      allocator = rhs.allocator;
+      steal(rhs);
+    }
+    return *this;
+  }
+
+  // copies the samples of a view
+  explicit AudioBufferC(const AudioBufferViewC<const FTYPE>& view, AudioAllocator* allocator_ = nullptr) :
+    channels(0),
+    usedChannels(0),
+    size(0),
+    usedSize(0),
+    data(NULL),
+    storage(NULL),
+    storageCapacity(0),
+    pointerCapacity(0),
+    allocator(allocator_ ? allocator_ : AudioAllocator::getDefault()),
+    layout(ASU_LAYOUT_PACKED),
+    tailPadding(0),
+    stride(0) {
+    resize(view.getNumberOfChannels(), view.getLength());
+    for (size_t ch = 0; ch < channels; ++ch) {
+      std::copy(view[ch], view[ch] + size, data[ch]);
     }
+    markAsWritten();
   }
   
   // this method mixes and expands
   AudioBufferC& mix(const AudioBufferC& rhs) {
-    if (!rhs.isSilent && rhs.usedChannels) {
-      if (this->isSilent || !usedChannels) {
+    if (!rhs.isSilent() && rhs.usedChannels) {
+      if (this->isSilent() || !usedChannels) {
         this->resize(rhs.channels, rhs.size);
         *this = rhs;
         return *this;
@@ -99,38 +181,31 @@ public:
     return *this;
   }
 
-  AudioBufferC(const AudioBufferC& rhs, bool convertToMono = false) {
-    data = nullptr;
+  // the copy has the allocator and the layout of rhs
+  AudioBufferC(const AudioBufferC& rhs, bool convertToMono = false) :
+    channels(0),
+    usedChannels(0),
+    size(0),
+    usedSize(0),
+    data(NULL),
+    storage(NULL),
+    storageCapacity(0),
+    pointerCapacity(0),
+    allocator(rhs.allocator),
+    layout(rhs.layout),
+    tailPadding(rhs.tailPadding),
+    stride(0) {
     if (convertToMono && rhs.usedChannels != 1) {
       if (rhs.usedChannels == 0) {
         assert(false);
       } else {
         this->resize(1, rhs.size);
-        for (int nChannel = 1; nChannel < rhs.usedChannels; ++nChannel) {
-          std::transform(rhs.data[0],
-            rhs.data[0] + usedSize,
-            rhs.data[nChannel],
-            data[0],
-            std::plus<FTYPE>());
-        }
-        std::transform(data[0], data[0] + usedSize,
-            data[0],
-            std::bind2nd(std::multiplies<FTYPE>(), 1.0F / (FTYPE)usedChannels));
+        usedSize = rhs.usedSize;
+        downmixFrom(rhs);
         usedChannels = 1;
       }
     } else {
-      this->resize(rhs.channels, rhs.size);
-      if (!rhs.isSilent) {
-        for(int nChannel = 0; nChannel < rhs.usedChannels; ++nChannel) {
-          FTYPE *pIn1 = data[nChannel];
-          FTYPE *pIn2 = rhs.data[nChannel];
-          std::copy(pIn2, pIn2 + size, pIn1);
-        }
-        this->isSilent = false;
-      } else {
-        this->isSilent = true;
-      }
-      usedChannels = rhs.usedChannels;
+      *this = rhs;
     }
   }
 
@@ -138,36 +213,184 @@ public:
     if (nchan_ == channels && size_ == size) {
       return;
     }
+    // the old samples are not kept, so there's nothing to copy if it grows
+    reserveStorage(nchan_, size_, false);
     usedChannels = channels = nchan_;
     size = size_;
-    if (data != nullptr) {
-      delete [] data;
-      delete [] storage;
-    }
-    data = new FTYPE*[channels];
-    storage = new FTYPE[size * channels];
     usedSize = size;
+    stride = getStrideFor(size_);
     for (unsigned int i = 0; i < channels; ++i)
-      data[i] = storage + i * size_;
+      data[i] = storage + i * stride;
+    // the new channels are silent, nothing is written until they are used
+    channelIsConstant.assign(channels, true);
+    channelConstantValue.assign(channels, FTYPE(0));
+  }
+
+  // makes room for nchan_ channels of size_ samples, so that resizing up to
+  // that won't allocate. The shape and the samples are not changed
+  void reserve(size_t nchan_, size_t size_) {
+    reserveStorage(nchan_, size_, true);
+  }
+
+  // how many samples per channel fit in the memory already allocated
+  size_t getCapacity() const {
+    size_t perChannel = channels ? storageCapacity / channels : storageCapacity;
+    if (layout == ASU_LAYOUT_ALIGNED) {
+      perChannel -= perChannel % getSamplesPerLine();
+    }
+    return perChannel > tailPadding ? perChannel - tailPadding : 0;
+  }
+
+  // with ASU_LAYOUT_ALIGNED every channel starts on an ASU_AUDIO_ALIGNMENT
+  // boundary and the stride is rounded up to it, so aligned loads can be used
+  // and threads working on different channels never share a cache line.
+  // tailPadding_ samples after the end of each channel belong to the buffer,
+  // kernels that process whole vectors can run over them, but their content
+  // is undefined. The samples are kept
+  void setLayout(AudioBufferLayout layout_, size_t tailPadding_ = 0) {
+    if (layout_ == layout && tailPadding_ == tailPadding) {
+      return;
+    }
+    layout = layout_;
+    tailPadding = tailPadding_;
+    if (channels == 0) {
+      return;
+    }
+    const size_t newStride = getStrideFor(size);
+    const size_t bytes = allocator->getGoodSize(channels * newStride * sizeof(FTYPE));
+    FTYPE* newStorage = (FTYPE*)allocator->allocate(bytes);
+    for (size_t ch = 0; ch < channels; ++ch) {
+      FTYPE* moved = newStorage + ch * newStride;
+      if (!channelIsConstant[ch]) {
+        std::copy(data[ch], data[ch] + size, moved);
+      }
+      data[ch] = moved;
+    }
+    allocator->deallocate(storage, storageCapacity * sizeof(FTYPE));
+    storage = newStorage;
+    storageCapacity = bytes / sizeof(FTYPE);
+    stride = newStride;
+  }
+
+  AudioBufferLayout getLayout() const { return layout; }
+  size_t getTailPadding() const { return tailPadding; }
+
+  // distance in samples between the starts of two consecutive channels
+  size_t getStride() const { return stride; }
+
+  // frees the memory, the buffer is left empty
+  void release() {
+    if (data != nullptr) {
+      allocator->deallocate(data, pointerCapacity * sizeof(FTYPE*));
+    }
+    if (storage != nullptr) {
+      allocator->deallocate(storage, storageCapacity * sizeof(FTYPE));
+    }
+    data = NULL;
+    storage = NULL;
+    pointerCapacity = storageCapacity = stride = 0;
+    channels = usedChannels = size = usedSize = 0;
+    channelIsConstant.clear();
+    channelConstantValue.clear();
+  }
+
+  AudioAllocator* getAllocator() const { return allocator; }
+
+  // views over the used channels, from offset for length samples (up to
+  // usedSize by default). Constant channels are written out first
+  AudioBufferViewC<FTYPE> getView(size_t offset = 0, size_t length = (size_t)-1) {
+    materialize();
+    assert(offset <= usedSize);
+    return AudioBufferViewC<FTYPE>(data, usedChannels, offset, std::min(length, usedSize - offset));
   }
 
+  AudioBufferViewC<const FTYPE> getConstView(size_t offset = 0, size_t length = (size_t)-1) {
+    materialize();
+    return static_cast<const AudioBufferC&>(*this).getConstView(offset, length);
+  }
+
+  // the const accessors never write, so a const buffer can be read from many
+  // threads: its channels must have been written out with materialize()
+  AudioBufferViewC<const FTYPE> getConstView(size_t offset = 0, size_t length = (size_t)-1) const {
+    for (size_t ch = 0; ch < usedChannels; ++ch) {
+      assert(!channelIsConstant[ch]);
+    }
+    assert(offset <= usedSize);
+    return AudioBufferViewC<const FTYPE>(data, usedChannels, offset, std::min(length, usedSize - offset));
+  }
+
+  // the accessors write out constant channels, so the samples can be used
   FTYPE* operator[] (const size_t channel) {
+    materialize(channel);
     return data[channel];
   }
 
-  FTYPE* getChannelData (const size_t channel) const {
+  FTYPE* getChannelData (const size_t channel) {
     assert(channel < usedChannels);
+    materialize(channel);
+    return data[channel];
+  }
+
+  FTYPE* getChannelData (const size_t channel) const {
+    assert(channel < usedChannels && !channelIsConstant[channel]);
     return data[channel];
   }
 
+  // writes out the samples of the constant channels
+  void materialize() {
+    for (size_t ch = 0; ch < usedChannels; ++ch) {
+      materialize(ch);
+    }
+  }
+
+  // true if every used channel is constant and zero
+  bool isSilent() const {
+    for (size_t ch = 0; ch < usedChannels; ++ch) {
+      if (!channelIsConstant[ch] || channelConstantValue[ch] != FTYPE(0)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // marks every channel as constant with value, without writing the samples.
+  // Setting it to false writes out the channels that were constant
+  void setIsConstant(bool isConstant, FTYPE value = FTYPE(0)) {
+    for (size_t ch = 0; ch < channels; ++ch) {
+      setChannelIsConstant(ch, isConstant, value);
+    }
+  }
+
+  void setChannelIsConstant(size_t channel, bool isConstant, FTYPE value = FTYPE(0)) {
+    if (isConstant) {
+      channelIsConstant[channel] = true;
+      channelConstantValue[channel] = value;
+    } else {
+      materialize(channel);
+    }
+  }
+
+  // to be called after writing samples directly through data: the channels
+  // are not constant anymore, and whatever they held is not written out
+  void markAsWritten() {
+    std::fill(channelIsConstant.begin(), channelIsConstant.end(), false);
+  }
+
+  void markAsWritten(size_t channel) {
+    channelIsConstant[channel] = false;
+  }
+
   void zero(int count_ = -1, int position_ = 0) {
     if (count_ == -1) {
-      isSilent = true;
+      setIsConstant(true, FTYPE(0));
       return;
     }
-    assert(size >= position_ + count_);
-    for (unsigned int i = 0; i < usedChannels; ++i)
+    assert(size >= (size_t)(position_ + count_));
+    for (unsigned int i = 0; i < usedChannels; ++i) {
+      if (channelIsConstant[i] && channelConstantValue[i] == FTYPE(0)) continue;
+      materialize(i);
       std::fill(data[i] + position_, data[i] + position_ + count_, FTYPE(0));
+    }
   }
   
   AudioBufferC& zeroAndcopy(const AudioBufferC& rhs) {
@@ -175,104 +398,164 @@ public:
     if (!usedChannels) {
       return *this;
     }
-    if (!rhs.isSilent) {
-      for(int nChannel = 0; nChannel < rhs.usedChannels; ++nChannel) {
-        FTYPE *pIn1 = data[nChannel];
-        FTYPE *pIn2 = rhs.data[nChannel];
-        std::copy(pIn2, pIn2 + size, pIn1);
+    if (!rhs.isSilent()) {
+      for (size_t nChannel = 0; nChannel < rhs.usedChannels; ++nChannel) {
+        copyChannel(rhs, nChannel, nChannel);
       }
       usedChannels = std::max(usedChannels, rhs.usedChannels);
-      isSilent = false;
     }
     return *this;
   }
   
   AudioBufferC& operator=(const AudioBufferC& rhs) {
+    if (this == &rhs) {
+      return *this;
+    }
     this->resize(rhs.channels, rhs.size);
-    if (!rhs.isSilent) {
-      for(int nChannel = 0; nChannel < rhs.usedChannels; ++nChannel) {
-        FTYPE *pIn1 = data[nChannel];
-        FTYPE *pIn2 = rhs.data[nChannel];
-        std::copy(pIn2, pIn2 + size, pIn1);
-      }
-      this->isSilent = false;
-    } else {
-      this->isSilent = true;
+    for (size_t nChannel = 0; nChannel < rhs.usedChannels; ++nChannel) {
+      copyChannel(rhs, nChannel, nChannel);
     }
     usedChannels = rhs.usedChannels;
+    usedSize = rhs.usedSize;
     return *this;
   }
   
   template <class RHST>
   AudioBufferC& operator=(const AudioBufferC<RHST>& rhs) {
     this->resize(rhs.channels, rhs.size);
-    if (!rhs.isSilent) {
-      for(int nChannel = 0; nChannel < rhs.usedChannels; ++nChannel) {
-        FTYPE *pIn1 = data[nChannel];
+    for (size_t nChannel = 0; nChannel < rhs.usedChannels; ++nChannel) {
+      if (rhs.channelIsConstant[nChannel]) {
+        setChannelIsConstant(nChannel, true, (FTYPE)rhs.channelConstantValue[nChannel]);
+      } else {
         RHST *pIn2 = rhs.data[nChannel];
-        std::copy(pIn2, pIn2 + size, pIn1);
+        std::copy(pIn2, pIn2 + size, data[nChannel]);
+        channelIsConstant[nChannel] = false;
       }
-      this->isSilent = false;
-    } else {
-      this->isSilent = true;
     }
     usedChannels = rhs.usedChannels;
+    usedSize = rhs.usedSize;
+    return *this;
+  }
+
+  // applies Op sample by sample between this buffer and rhs, that can be mono
+  // or have the same channels. Constant channels are combined without
+  // touching the samples
+  template <template <class> class Op>
+  AudioBufferC& transform(const AudioBufferC& rhs, size_t numSamples) {
+    assert(rhs.usedChannels == 1 || rhs.usedChannels == usedChannels);
+    Op<FTYPE> op;
+    for (size_t ch = 0; ch < usedChannels; ++ch) {
+      applyOp(op, *this, ch, rhs, rhs.usedChannels == 1 ? 0 : ch, *this, ch, numSamples);
+    }
     return *this;
   }
+
+  // out = lhs Op rhs, a mono operand is applied to all the channels of the
+  // other one. out is resized if it's too small
+  template <template <class> class Op>
+  static void transform(const AudioBufferC& lhs, const AudioBufferC& rhs, AudioBufferC& out, size_t numSamples) {
+    assert(lhs.usedChannels == 1 || rhs.usedChannels == 1 || lhs.usedChannels == rhs.usedChannels);
+    const size_t outChannels = std::max(lhs.usedChannels, rhs.usedChannels);
+    if (out.channels < outChannels || out.size < numSamples) {
+      out.resize(std::max(out.channels, outChannels), std::max(out.size, numSamples));
+    }
+    out.usedChannels = outChannels;
+    Op<FTYPE> op;
+    for (size_t ch = 0; ch < outChannels; ++ch) {
+      applyOp(op,
+        lhs, lhs.usedChannels == 1 ? 0 : ch,
+        rhs, rhs.usedChannels == 1 ? 0 : ch,
+        out, ch, numSamples);
+    }
+  }
   
   // this handles just mono to stereo, and "same to same" for now
   AudioBufferC& sum(const AudioBufferC& rhs, int numSamples) {
-    if (!usedChannels) {
+    if (rhs.isSilent()) {
+      return *this;
+    }
+    return mixIn(rhs, rhs.usedChannels, numSamples, FTYPE(1));
+  }
+
+  // same as sum, but rhs is scaled by linearGain in the same pass
+  AudioBufferC& sumWithGain(const AudioBufferC& rhs, int numSamples, FTYPE linearGain) {
+    if (rhs.isSilent()) {
+      return *this;
+    }
+    return mixIn(rhs, rhs.usedChannels, numSamples, linearGain);
+  }
+
+  // the same for samples that are not in an AudioBufferC
+  AudioBufferC& sum(const AudioBufferViewC<const FTYPE>& rhs, int numSamples) {
+    return mixIn(rhs, rhs.getNumberOfChannels(), numSamples, FTYPE(1));
+  }
+
+  AudioBufferC& sumWithGain(const AudioBufferViewC<const FTYPE>& rhs, int numSamples, FTYPE linearGain) {
+    return mixIn(rhs, rhs.getNumberOfChannels(), numSamples, linearGain);
+  }
+
+  // mixes the channels of rhs into this buffer through matrix, that must have
+  // as many inputs as rhs has channels. The buffer is expanded to the outputs
+  // of the matrix if it uses less channels
+  AudioBufferC& sum(const AudioBufferC& rhs, const MixingMatrixC<FTYPE>& matrix, int numSamples) {
+    assert(rhs.usedChannels == matrix.getNumberOfInputs());
+    assert(channels >= matrix.getNumberOfOutputs());
+    if (rhs.isSilent() || !rhs.usedChannels) {
       return *this;
     }
-    if (!rhs.isSilent && rhs.usedChannels) {
-      if (this->isSilent) {
-        for (unsigned int i = 0; i < std::max(usedChannels, rhs.usedChannels); ++i)
-          std::fill(data[i] , data[i] + size, FTYPE(0));
-        isSilent = false;
-      }
-      // TODO generalize for ambisonics :)
-      if (usedChannels == rhs.usedChannels) {
-        for (int chan = 0; chan < std::max(usedChannels, rhs.usedChannels); ++chan) {
-          float *pL1 = data[chan];
-          float *pM2 = rhs.data[chan];
-          std::transform(pL1, pL1 + numSamples, pM2, pL1, std::plus<FTYPE>());
+    const size_t outputs = matrix.getNumberOfOutputs();
+    for (size_t i = usedChannels; i < outputs; ++i) {
+      setChannelIsConstant(i, true, FTYPE(0));
+    }
+    usedChannels = std::max(usedChannels, outputs);
+    // constant inputs add up to an offset, the output stays constant if all
+    // of its inputs are
+    for (size_t out = 0; out < outputs; ++out) {
+      const std::vector<typename MixingMatrixC<FTYPE>::Route>& routes = matrix.getRoutes(out);
+      FTYPE offset = FTYPE(0);
+      bool varying = false;
+      for (size_t r = 0; r < routes.size(); ++r) {
+        if (rhs.channelIsConstant[routes[r].input]) {
+          offset += rhs.channelConstantValue[routes[r].input] * routes[r].gain;
+        } else {
+          varying = true;
         }
-      } else if (usedChannels == 2 && rhs.usedChannels == 1) {
-        float *pL1 = data[0];
-        float *pR1 = data[1];
-        float *pM2 = rhs.data[0];
-        std::transform(pL1, pL1 + numSamples, pM2, pL1, std::plus<FTYPE>());
-        std::transform(pR1, pR1 + numSamples, pM2, pR1, std::plus<FTYPE>());
-      } else if (usedChannels == 1 && rhs.usedChannels == 2){
-        float *pL1 = data[0];
-        float *pR1 = data[1];
-        float *pL2 = rhs.data[0];
-        float *pR2 = rhs.data[1];
-        std::transform(pL1, pL1 + numSamples, pR2, pR1, std::plus<FTYPE>());
-        std::transform(pL1, pL1 + numSamples, pL2, pL1, std::plus<FTYPE>());
-      } else {
-        assert(false && "Summing is not supported for this channel configuration");
       }
-      usedChannels = std::max(usedChannels, rhs.usedChannels);
-      this->isSilent = false;
+      if (!varying && channelIsConstant[out] && (size_t)numSamples >= usedSize) {
+        channelConstantValue[out] += offset;
+        continue;
+      }
+      if (varying || offset != FTYPE(0)) {
+        materialize(out);
+      }
+      if (offset != FTYPE(0)) {
+        kernels::offset(data[out], numSamples, offset);
+      }
+    }
+    // in blocks, so that the inputs stay in cache while every output reads them
+    for (int start = 0; start < numSamples; start += MIX_BLOCK_SIZE) {
+      const size_t count = std::min(numSamples - start, (int)MIX_BLOCK_SIZE);
+      for (size_t out = 0; out < outputs; ++out) {
+        mixRoutes(data[out] + start, rhs, matrix.getRoutes(out), start, count);
+      }
     }
     return *this;
   }
+
     // this handles just mono to stereo, and "same to same" for now
   AudioBufferC& sum(const AudioBufferC& rhs, int numSamples, float panning) {
     assert(false);
     // todo: this is a quick hack just for game of thrones
-    assert(!rhs.isSilent && !this->isSilent && usedChannels == 2 && rhs.usedChannels == 1);
+    assert(!rhs.isSilent() && !this->isSilent() && usedChannels == 2 && rhs.usedChannels == 1);
 
-    if (usedSize < numSamples) {
+    if (usedSize < (size_t)numSamples) {
       resize(2, numSamples, true);
     }
     PanPot panL(panning, 0);
     PanPot panR(panning, 1);
-    float *pL1 = data[0];
-    float *pR1 = data[1];
-    float *pM2 = rhs.data[0];
+    float *pL1 = (*this)[0];
+    float *pR1 = (*this)[1];
+    float *pM2 = rhs.getChannelData(0);
     std::transform(pL1, pL1 + numSamples, pM2, pL1, panL);
     std::transform(pR1, pR1 + numSamples, pM2, pR1, panR);
 
@@ -283,35 +566,63 @@ public:
   AudioBufferC& fill(const FTYPE value, const int numSamples, int position_ = 0) {  
     assert(usedChannels > 0);
     if (numSamples == 0) return *this;
-    for (unsigned int i = 0; i < usedChannels; ++i)
+    for (unsigned int i = 0; i < usedChannels; ++i) {
+      // filling the whole channel only needs the flag
+      if (position_ == 0 && (size_t)numSamples >= usedSize) {
+        setChannelIsConstant(i, true, value);
+        continue;
+      }
+      materialize(i);
       std::fill(data[i] + position_, data[i] + position_ + numSamples, value);
+    }
     return *this;
   }
   
-  void createNoise(FTYPE min_, FTYPE max_) {    
-    std::mt19937 generator;
-    std::uniform_real_distribution<FTYPE> uniform_distribution(min_, max_);
-    auto my_rand = std::bind(uniform_distribution, generator);
-    for (unsigned int i = 0; i < usedChannels; ++i)
-      std::generate(data[i], data[i] + usedSize, my_rand);
+  // Noise generators overwrite the used samples, every channel gets its own
+  // stream. Without a seed each call gives new noise, the same in every run
+  // the noise covers the used samples, those past usedSize keep the value of
+  // a constant channel
+  void createNoise(FTYPE min_, FTYPE max_, uint64_t seed_ = nextNoiseSeed()) {
+    for (unsigned int i = 0; i < usedChannels; ++i) {
+      materialize(i);
+      NoiseGenerator(seed_, i).uniform(data[i], usedSize, min_, max_);
+    }
+  }
+
+  void createGaussianNoise(FTYPE mean_, FTYPE deviation_, uint64_t seed_ = nextNoiseSeed()) {
+    for (unsigned int i = 0; i < usedChannels; ++i) {
+      materialize(i);
+      NoiseGenerator(seed_, i).gaussian(data[i], usedSize, mean_, deviation_);
+    }
+  }
+
+  void createPinkNoise(FTYPE amplitude_, uint64_t seed_ = nextNoiseSeed()) {
+    for (unsigned int i = 0; i < usedChannels; ++i) {
+      materialize(i);
+      NoiseGenerator(seed_, i).pink(data[i], usedSize, amplitude_);
+    }
   }
   
   void addSine(FTYPE freq_, FTYPE sr_, FTYPE amp_ = 1.0) {
-//    class MyOp {
-//      MyOp(
-//      FTYPE operator()() {
-//        FTYPE toReturn = sin(phaseAcc);
-//        phaseAcc += phaseInc;
-//        return toReturn;
-//      }
-//      FTYPE phaseAcc;
-//      FTYPE phaseInc;
-//    };
-//    MyOp a;
-//    a.phaseInc =
-    for (int i = 0; i < size; ++i) {
-      for (int ch = 0; ch < usedChannels; ++ch) {
-        data[ch][i] += amp_ * sin(2.0 * M_PI * freq_ * (FTYPE)i / sr_);
+    OscillatorBankC<FTYPE> oscillator(sr_);
+    oscillator.addPartial(freq_, amp_);
+    addOscillators(oscillator);
+  }
+
+  // adds the next size samples of the bank to every used channel. They are
+  // generated once, a block at a time, and summed into each channel
+  void addOscillators(OscillatorBankC<FTYPE>& bank) {
+    const size_t blockSize = 1024;
+    std::vector<FTYPE> block(std::min((size_t)size, blockSize));
+    for (size_t ch = 0; ch < usedChannels; ++ch) {
+      materialize(ch);
+    }
+    for (size_t start = 0; start < size; start += blockSize) {
+      const size_t count = std::min(blockSize, size - start);
+      std::fill(block.begin(), block.begin() + count, FTYPE(0));
+      bank.addTo(&block[0], count);
+      for (size_t ch = 0; ch < usedChannels; ++ch) {
+        kernels::add(data[ch] + start, &block[0], count);
       }
     }
   }
@@ -320,68 +631,135 @@ public:
     assert(false);
   }
   
+  // the largest absolute value between startPosition and endPosition in any
+  // used channel, and where it is. Negative peaks count as well
   void findPeak (size_t* index, FTYPE* val, size_t startPosition, size_t endPosition) {
-    *val = std::numeric_limits<FTYPE>::min();
-    size_t tempIndex(-1);
-    FTYPE tempVal(0);
-    for (int ch = 0; ch < usedChannels; ++ch) {
-      tempIndex = max_index( data[ch] + startPosition, endPosition - startPosition, &tempVal );
-      if (tempVal > *val) {
-        *val = tempVal;
-        *index = tempIndex;
+    *val = FTYPE(0);
+    *index = startPosition;
+    for (size_t ch = 0; ch < usedChannels; ++ch) {
+      kernels::StatisticsC<FTYPE> stats = getStatistics(ch, startPosition, endPosition - startPosition);
+      if (stats.peak > *val) {
+        *val = stats.peak;
+        *index = startPosition + stats.peakIndex;
+      }
+    }
+  }
+
+  // min, max, peak, sum, sum of squares and clipped samples of a channel,
+  // from start for length samples (up to usedSize), in a single pass.
+  // Constant channels are not written out
+  kernels::StatisticsC<FTYPE> getStatistics(size_t channel, size_t start = 0, size_t length = (size_t)-1,
+    FTYPE clipLevel = FTYPE(1)) const {
+    assert(channel < usedChannels && start <= usedSize);
+    length = std::min(length, usedSize - start);
+    kernels::StatisticsC<FTYPE> stats;
+    if (channelIsConstant[channel]) {
+      if (length > 0) {
+        const FTYPE value = channelConstantValue[channel];
+        stats.length = length;
+        stats.min = stats.max = value;
+        stats.peak = std::fabs(value);
+        stats.sum = (double)value * length;
+        stats.sumOfSquares = (double)value * value * length;
+        stats.clipped = stats.peak >= clipLevel ? length : 0;
       }
+      return stats;
+    }
+    kernels::statistics(data[channel] + start, length, clipLevel, &stats);
+    return stats;
+  }
+
+  // the statistics of every blockSize samples of a channel, the last block
+  // may be shorter. Enough to draw a waveform overview
+  std::vector<kernels::StatisticsC<FTYPE> > getOverview(size_t channel, size_t blockSize, FTYPE clipLevel = FTYPE(1)) const {
+    assert(blockSize > 0);
+    std::vector<kernels::StatisticsC<FTYPE> > blocks;
+    blocks.reserve((usedSize + blockSize - 1) / blockSize);
+    for (size_t start = 0; start < usedSize; start += blockSize) {
+      blocks.push_back(getStatistics(channel, start, blockSize, clipLevel));
     }
-    *index += startPosition;
+    return blocks;
   }
   
   size_t findZeroCrossing(size_t startPosition, size_t before_sample, size_t in_channel) {
     if (before_sample < startPosition + 2) {
       return 0;
     }
+    materialize(in_channel);
     int ci(before_sample);
     --ci;
-    while (ci >= startPosition && data[in_channel][ci] * data[in_channel][ci+1] > 0 ) {
+    while (ci >= (int)startPosition && data[in_channel][ci] * data[in_channel][ci+1] > 0 ) {
       --ci;
     }
-    return (ci < startPosition) ? startPosition : ci;
+    return (ci < (int)startPosition) ? startPosition : ci;
   }
   
-  #ifdef USE_SAMPLERATE
-  
-  void resample(float fromSr_, float toSr_) {
-    SRC_DATA srcdata;
-    srcdata.src_ratio = toSr_ / fromSr_;
-    int newsize = ceil(size * srcdata.src_ratio);
-    srcdata.input_frames = size;
-    srcdata.output_frames = newsize;
-    
-    FTYPE** newdata = new FTYPE*[channels];
-    FTYPE* newstorage = new FTYPE[newsize * channels];
-    for (int i = 0; i < channels; ++i)
-      newdata[i] = newstorage + i * newsize;
-    
-    for(int nChannel = 0; nChannel < channels; ++nChannel) {
-      srcdata.data_in = data[nChannel];
-      srcdata.data_out = newdata[nChannel];
-      if (src_simple (&srcdata, SRC_SINC_MEDIUM_QUALITY, 1)) {
-        exit(1);
-      }
-    }
-    delete [] data;
-    delete [] storage;
-    data = newdata;
-    storage = newstorage;
-    usedSize = size = newsize;
-    
+  // Converts the used samples from fromSr_ to toSr_, constant channels stay
+  // constant. Going down in rate the samples are converted where they are,
+  // going up the storage grows once. False if a rate isn't valid
+  bool resample(float fromSr_, float toSr_, ResamplerQuality quality = ASU_RESAMPLER_NORMAL) {
+    if (!(fromSr_ > 0) || !(toSr_ > 0)) {
+      return false;
+    }
+    if (std::llround(fromSr_) == std::llround(toSr_) || channels == 0) {
+      return true;
+    }
+    std::vector<FTYPE*> source, destination;
+    for (size_t ch = 0; ch < channels; ++ch) {
+      if (!channelIsConstant[ch]) {
+        source.push_back(data[ch]);
+      }
+    }
+    ResamplerC<FTYPE> resampler;
+    if (!source.empty() && !resampler.init(fromSr_, toSr_, source.size(), quality)) {
+      return false;
+    }
+    const size_t newSize = (size_t)std::ceil((double)usedSize * std::llround(toSr_) / std::llround(fromSr_));
+    const size_t newStride = getStrideFor(newSize);
+    const bool inPlace = newSize <= usedSize;
+    FTYPE* newStorage = storage;
+    size_t newStorageBytes = 0;
+    if (!inPlace) {
+      newStorageBytes = allocator->getGoodSize(newStride * channels * sizeof(FTYPE));
+      newStorage = (FTYPE*)allocator->allocate(newStorageBytes);
+    }
+    for (size_t ch = 0; ch < channels; ++ch) {
+      FTYPE* channel = inPlace ? data[ch] : newStorage + ch * newStride;
+      if (!channelIsConstant[ch]) {
+        destination.push_back(channel);
+      }
+      data[ch] = channel;
+    }
+    if (!source.empty()) {
+      assert(resampler.getOutputLength(usedSize) == newSize);
+      // the output never overtakes the input when the rate goes down
+      const size_t blockSize = 4096;
+      size_t written = 0;
+      for (size_t position = 0; position < usedSize; position += blockSize) {
+        AudioBufferViewC<const FTYPE> input(&source[0], source.size(), position, std::min(blockSize, usedSize - position));
+        written += resampler.process(input, AudioBufferViewC<FTYPE>(&destination[0], destination.size(), written, newSize - written));
+      }
+      size_t count;
+      while ((count = resampler.flush(AudioBufferViewC<FTYPE>(&destination[0], destination.size(), written, newSize - written))) > 0) {
+        written += count;
+      }
+      assert(written == newSize);
+    }
+    if (!inPlace) {
+      allocator->deallocate(storage, storageCapacity * sizeof(FTYPE));
+      storage = newStorage;
+      storageCapacity = newStorageBytes / sizeof(FTYPE);
+      stride = newStride;
+    }
+    usedSize = size = newSize;
+    return true;
   }
   
-  #endif
-  
   void setUsedChannels(size_t usedChannels_) {
     assert(usedChannels_ <= channels && 3 > usedChannels_);
     if (usedChannels < usedChannels_) {
       for (unsigned int i = usedChannels; i < usedChannels_; ++i)
-        std::fill(data[i], data[i] + size, FTYPE(0));
+        setChannelIsConstant(i, true, FTYPE(0));
     }
     usedChannels = usedChannels_;
   }
@@ -389,6 +767,10 @@ public:
   void requantize(unsigned int toBits) {
     unsigned int halfRange = pow(2,toBits-1);
     for(unsigned int nChannel = 0; nChannel < usedChannels; ++nChannel) {
+      if (channelIsConstant[nChannel]) {
+        channelConstantValue[nChannel] = (int)(channelConstantValue[nChannel] * halfRange) / (float)halfRange;
+        continue;
+      }
       for(unsigned int sample = 0; sample < usedSize; ++sample) {
         data[nChannel][sample] = (int)(data[nChannel][sample] * halfRange) / (float)halfRange;
       }
@@ -397,41 +779,39 @@ public:
   
   void normalize() {
     if (usedChannels < 1) return;
-    FTYPE maximum, max, min;
-    maximum = 0;
-    max=0;
-    min=0;
-    for(int nChannel = 0; nChannel < usedChannels; ++nChannel) {
-      max = *std::max_element(data[nChannel],data[nChannel] + usedSize);
-      min = *std::min_element(data[nChannel],data[nChannel] + usedSize);
-      if (fabs(max)>fabs(min)) {
-        maximum = std::max(maximum, (FTYPE)fabs(max));
-      } else {
-        maximum = std::max(maximum, (FTYPE)fabs(min));
-      }
+    FTYPE maximum = 0;
+    for (size_t nChannel = 0; nChannel < usedChannels; ++nChannel) {
+      maximum = std::max(maximum, getStatistics(nChannel).peak);
     }
+    if (maximum == FTYPE(0)) return;
     applyGain(FTYPE(1)/maximum);
   }
   
   void removeDC() {
-    for(int nChannel = 0; nChannel < usedChannels; ++nChannel) {
-      float avg = std::accumulate(data[nChannel], data[nChannel] + size, .0F) / size;
-      std::transform(data[0], data[0] + usedSize,
-        data[0],
-        std::bind2nd(std::minus<FTYPE>(), avg));
+    if (usedSize == 0) return;
+    for (size_t nChannel = 0; nChannel < usedChannels; ++nChannel) {
+      if (channelIsConstant[nChannel]) {
+        channelConstantValue[nChannel] = FTYPE(0);
+        continue;
+      }
+      FTYPE avg = (FTYPE)getStatistics(nChannel).mean();
+      kernels::offset(data[nChannel], usedSize, -avg);
     }
   }
   
   void applyGain(FTYPE linearGain) {
-    for (int nChannel = 0; nChannel < usedChannels; ++nChannel) {
-      std::transform(data[nChannel], data[nChannel] + usedSize,
-        data[nChannel],
-        std::bind2nd(std::multiplies<FTYPE>(), linearGain));
+    for (size_t nChannel = 0; nChannel < usedChannels; ++nChannel) {
+      if (channelIsConstant[nChannel]) {
+        channelConstantValue[nChannel] *= linearGain;
+      } else {
+        kernels::scale(data[nChannel], usedSize, linearGain);
+      }
     }
   }
   
   void applyOnePole(FTYPE coefficient) {
-    for (int nChannel = 0; nChannel < usedChannels; ++nChannel) {
+    for (size_t nChannel = 0; nChannel < usedChannels; ++nChannel) {
+      materialize(nChannel);
       std::transform(data[nChannel]+1, data[nChannel] + usedSize,
         data[nChannel],
         data[nChannel],
@@ -445,32 +825,22 @@ public:
     } else if (usedChannels == 1) {
       return;
     }
-    for (int nChannel = 1; nChannel < usedChannels; ++nChannel) {
-      std::transform(data[0],
-        data[0] + usedSize,
-        data[nChannel],
-        data[0],
-        std::plus<FTYPE>());
-    }
-    std::transform(data[0], data[0] + usedSize,
-        data[0],
-        std::bind2nd(std::multiplies<FTYPE>(), 1.0F / (FTYPE)usedChannels));
+    downmixFrom(*this);
     usedChannels = 1;
   }
   
+  // returns the used samples interleaved
   std::unique_ptr<FTYPE[]> deinterleave() {
-    std::unique_ptr<FTYPE[]> toReturn(new float[usedSize * usedChannels]);
-    unsigned int currentOutputSample = 0;
-    for (int nSample = 0; nSample < usedSize; ++nSample) {
-      for (int nChannel = 0; nChannel < usedChannels; ++nChannel) {
-        toReturn.operator[](currentOutputSample++) = data[nChannel][nSample];
-      }
+    std::unique_ptr<FTYPE[]> toReturn(new FTYPE[usedSize * usedChannels]);
+    for (size_t nChannel = 0; nChannel < usedChannels; ++nChannel) {
+      materialize(nChannel);
     }
+    conversion::interleave((const FTYPE* const*)data, toReturn.get(), usedChannels, usedSize);
     return toReturn;
   }
   
   AudioBufferC& operator=(const float value) {
-    isSilent = true;
+    setIsConstant(true, FTYPE(0));
     channels = 1;
     return *this;
   }
@@ -479,21 +849,77 @@ public:
     outputConv.resize(inputSignal.usedChannels, inputSignal.size + impulse.size - 1);
     for (unsigned int chan = 0; chan < inputSignal.usedChannels; ++chan) {
       int k = 0, o = 0, i = 0;
-      float *inputData = inputSignal.data[chan];
-      float *impulseData = impulse.data[impulse.usedChannels > chan ? chan : 0];
+      float *inputData = inputSignal.getChannelData(chan);
+      float *impulseData = impulse.getChannelData(impulse.usedChannels > chan ? chan : 0);
       float *outputData = outputConv.data[chan];
-      for (o = 0; o < outputConv.size; ++o) {
+      for (o = 0; o < (int)outputConv.size; ++o) {
         outputData[o] = .0F;
-        for (k = 0; k < impulse.size; ++k) {
+        for (k = 0; k < (int)impulse.size; ++k) {
           i = o - k;
           if (i < 0)
             break;
-          if (i > inputSignal.size) {
+          if (i >= (int)inputSignal.size) {
             continue;
           }
           outputData[o] += inputData[i] * impulseData[k];
         }
       }
+      outputConv.markAsWritten(chan);
+    }
+  }
+
+  // Same result as convolveTd with a partitioned FFT convolution, for the used
+  // samples. The block size is picked from the impulse length if not given
+  static inline void convolve(const AudioBufferC& inputSignal, const AudioBufferC& impulse, AudioBufferC& outputConv,
+    size_t blockSize = 0) {
+    assert(&inputSignal != &outputConv && &impulse != &outputConv);
+    if (inputSignal.usedSize == 0 || impulse.usedSize == 0) {
+      outputConv.resize(inputSignal.usedChannels, 0);
+      return;
+    }
+    const size_t numberOfChannels = inputSignal.usedChannels;
+    const size_t outputLength = inputSignal.usedSize + impulse.usedSize - 1;
+    if (blockSize == 0) {
+      blockSize = ConvolverC<FTYPE>::getDefaultBlockSize(impulse.usedSize);
+    }
+    // the inputs are not written to, a constant impulse is written out in a copy
+    AudioBufferC<FTYPE> writtenImpulse;
+    const AudioBufferC* source = &impulse;
+    if (std::find(impulse.channelIsConstant.begin(), impulse.channelIsConstant.begin() + impulse.usedChannels, true) !=
+        impulse.channelIsConstant.begin() + impulse.usedChannels) {
+      writtenImpulse = impulse;
+      writtenImpulse.materialize();
+      source = &writtenImpulse;
+    }
+    ConvolverC<FTYPE> convolver;
+    if (!convolver.init(source->getConstView(), numberOfChannels, blockSize)) {
+      assert(false);
+      return;
+    }
+    outputConv.resize(numberOfChannels, outputLength);
+    outputConv.markAsWritten();
+    // the last blocks run past the input, they see zeros
+    std::vector<FTYPE> blockSamples(numberOfChannels * blockSize);
+    std::vector<FTYPE*> blockPointers(numberOfChannels);
+    for (size_t ch = 0; ch < numberOfChannels; ++ch) {
+      blockPointers[ch] = &blockSamples[ch * blockSize];
+    }
+    AudioBufferViewC<FTYPE> block(&blockPointers[0], numberOfChannels, 0, blockSize);
+    for (size_t position = 0; position < outputLength; position += blockSize) {
+      const size_t inputCount = position < inputSignal.usedSize ? std::min(blockSize, inputSignal.usedSize - position) : 0;
+      for (size_t ch = 0; ch < numberOfChannels; ++ch) {
+        if (inputSignal.channelIsConstant[ch]) {
+          std::fill(blockPointers[ch], blockPointers[ch] + inputCount, inputSignal.channelConstantValue[ch]);
+        } else {
+          std::copy(inputSignal.data[ch] + position, inputSignal.data[ch] + position + inputCount, blockPointers[ch]);
+        }
+        std::fill(blockPointers[ch] + inputCount, blockPointers[ch] + blockSize, FTYPE(0));
+      }
+      convolver.process(block, block);
+      const size_t outputCount = std::min(blockSize, outputLength - position);
+      for (size_t ch = 0; ch < numberOfChannels; ++ch) {
+        std::copy(blockPointers[ch], blockPointers[ch] + outputCount, outputConv.data[ch] + position);
+      }
     }
   }
   
@@ -502,9 +928,267 @@ public:
   size_t size;
   size_t usedSize;
   FTYPE** data;
-  bool isSilent;
+  // when a channel is constant its samples are not kept up to date, the
+  // value is written out the first time they are accessed through a
+  // non-const accessor
+  std::vector<bool> channelIsConstant;
+  std::vector<FTYPE> channelConstantValue;
 private:
+  static const int MIX_BLOCK_SIZE = 1024;
+
+  void reserveStorage(size_t nchan_, size_t size_, bool keepSamples) {
+    if (nchan_ > pointerCapacity) {
+      const size_t bytes = allocator->getGoodSize(nchan_ * sizeof(FTYPE*));
+      FTYPE** newData = (FTYPE**)allocator->allocate(bytes);
+      if (data != nullptr) {
+        std::copy(data, data + channels, newData);
+        allocator->deallocate(data, pointerCapacity * sizeof(FTYPE*));
+      }
+      data = newData;
+      pointerCapacity = bytes / sizeof(FTYPE*);
+    }
+    if (nchan_ * getStrideFor(size_) > storageCapacity) {
+      const size_t bytes = allocator->getGoodSize(nchan_ * getStrideFor(size_) * sizeof(FTYPE));
+      FTYPE* newStorage = (FTYPE*)allocator->allocate(bytes);
+      // the channels keep their layout, at the start of the new block
+      for (size_t ch = 0; ch < channels; ++ch) {
+        FTYPE* moved = newStorage + (data[ch] - storage);
+        if (keepSamples && !channelIsConstant[ch]) {
+          std::copy(data[ch], data[ch] + size, moved);
+        }
+        data[ch] = moved;
+      }
+      if (storage != nullptr) {
+        allocator->deallocate(storage, storageCapacity * sizeof(FTYPE));
+      }
+      storage = newStorage;
+      storageCapacity = bytes / sizeof(FTYPE);
+    }
+  }
+
+  static size_t getSamplesPerLine() {
+    return std::max((size_t)1, (size_t)ASU_AUDIO_ALIGNMENT / sizeof(FTYPE));
+  }
+
+  size_t getStrideFor(size_t size_) const {
+    size_t padded = size_ + tailPadding;
+    if (layout == ASU_LAYOUT_ALIGNED) {
+      const size_t perLine = getSamplesPerLine();
+      padded = (padded + perLine - 1) / perLine * perLine;
+    }
+    return padded;
+  }
+
+  void materialize(size_t channel) {
+    if (channelIsConstant[channel]) {
+      std::fill(data[channel], data[channel] + size, channelConstantValue[channel]);
+      channelIsConstant[channel] = false;
+    }
+  }
+
+  void copyChannel(const AudioBufferC& rhs, size_t from, size_t to) {
+    if (rhs.channelIsConstant[from]) {
+      setChannelIsConstant(to, true, rhs.channelConstantValue[from]);
+    } else {
+      std::copy(rhs.data[from], rhs.data[from] + std::min(size, rhs.size), data[to]);
+      channelIsConstant[to] = false;
+    }
+  }
+
+  // channel 0 = average of the used channels of source, that can be this
+  void downmixFrom(const AudioBufferC& source) {
+    const size_t numberOfChannels = source.usedChannels;
+    FTYPE constantSum = FTYPE(0);
+    bool written = false;
+    for (size_t ch = 0; ch < numberOfChannels; ++ch) {
+      if (source.channelIsConstant[ch]) {
+        constantSum += source.channelConstantValue[ch];
+      } else if (!written) {
+        if (source.data[ch] != data[0]) {
+          std::copy(source.data[ch], source.data[ch] + usedSize, data[0]);
+        }
+        written = true;
+      } else {
+        kernels::add(data[0], source.data[ch], usedSize);
+      }
+    }
+    const FTYPE gain = FTYPE(1) / (FTYPE)numberOfChannels;
+    if (!written) {
+      setChannelIsConstant(0, true, constantSum * gain);
+      return;
+    }
+    channelIsConstant[0] = false;
+    if (constantSum != FTYPE(0)) {
+      kernels::offset(data[0], usedSize, constantSum);
+    }
+    kernels::scale(data[0], usedSize, gain);
+  }
+
+  // one channel of out = a Op b. out can be a or b
+  template <class Op>
+  static void applyOp(Op& op,
+                      const AudioBufferC& a, size_t aChannel,
+                      const AudioBufferC& b, size_t bChannel,
+                      AudioBufferC& out, size_t outChannel,
+                      size_t numSamples) {
+    const bool aIsConstant = a.channelIsConstant[aChannel];
+    const bool bIsConstant = b.channelIsConstant[bChannel];
+    const FTYPE aValue = a.channelConstantValue[aChannel];
+    const FTYPE bValue = b.channelConstantValue[bChannel];
+    if (aIsConstant && bIsConstant && numSamples >= out.usedSize) {
+      out.setChannelIsConstant(outChannel, true, op(aValue, bValue));
+      return;
+    }
+    if (numSamples < out.usedSize) {
+      // the samples after numSamples must be kept
+      out.materialize(outChannel);
+    }
+    FTYPE* dst = out.data[outChannel];
+    const FTYPE* aData = a.data[aChannel];
+    const FTYPE* bData = b.data[bChannel];
+    if (aIsConstant && bIsConstant) {
+      std::fill(dst, dst + numSamples, op(aValue, bValue));
+    } else if (aIsConstant) {
+      for (size_t i = 0; i < numSamples; ++i) dst[i] = op(aValue, bData[i]);
+    } else if (bIsConstant) {
+      for (size_t i = 0; i < numSamples; ++i) dst[i] = op(aData[i], bValue);
+    } else {
+      std::transform(aData, aData + numSamples, bData, dst, op);
+    }
+    out.channelIsConstant[outChannel] = false;
+  }
+
+  // dst += the varying inputs in routes, two at a time. The constant ones
+  // have already been added
+  static void mixRoutes(FTYPE* dst, const AudioBufferC& rhs,
+                        const std::vector<typename MixingMatrixC<FTYPE>::Route>& routes,
+                        size_t start, size_t count) {
+    const typename MixingMatrixC<FTYPE>::Route* pending = nullptr;
+    for (size_t r = 0; r < routes.size(); ++r) {
+      if (rhs.channelIsConstant[routes[r].input]) {
+        continue;
+      }
+      if (pending == nullptr) {
+        pending = &routes[r];
+        continue;
+      }
+      kernels::addScaled2(dst,
+        rhs.data[pending->input] + start, pending->gain,
+        rhs.data[routes[r].input] + start, routes[r].gain,
+        count);
+      pending = nullptr;
+    }
+    if (pending != nullptr) {
+      if (pending->gain == FTYPE(1)) {
+        kernels::add(dst, rhs.data[pending->input] + start, count);
+      } else {
+        kernels::addScaled(dst, rhs.data[pending->input] + start, count, pending->gain);
+      }
+    }
+  }
+
+  struct ChannelSource {
+    const FTYPE* samples;
+    bool isConstant;
+    FTYPE value;
+  };
+
+  static ChannelSource getSource(const AudioBufferC& rhs, size_t channel) {
+    ChannelSource source = { rhs.data[channel], rhs.channelIsConstant[channel], rhs.channelConstantValue[channel] };
+    return source;
+  }
+
+  static ChannelSource getSource(const AudioBufferViewC<const FTYPE>& rhs, size_t channel) {
+    ChannelSource source = { rhs[channel], false, FTYPE(0) };
+    return source;
+  }
+
+  // dst channel += src * linearGain, constant sources are added as offsets
+  // and silent ones are skipped
+  void mixChannel(size_t dst, const ChannelSource& src, int numSamples, FTYPE linearGain) {
+    if (src.isConstant) {
+      const FTYPE value = src.value * linearGain;
+      if (value == FTYPE(0)) {
+        return;
+      }
+      if (channelIsConstant[dst] && (size_t)numSamples >= usedSize) {
+        channelConstantValue[dst] += value;
+      } else {
+        materialize(dst);
+        kernels::offset(data[dst], numSamples, value);
+      }
+      return;
+    }
+    if (channelIsConstant[dst] && channelConstantValue[dst] == FTYPE(0) && (size_t)numSamples >= usedSize) {
+      // adding to silence is a copy
+      std::copy(src.samples, src.samples + numSamples, data[dst]);
+      if (linearGain != FTYPE(1)) {
+        kernels::scale(data[dst], numSamples, linearGain);
+      }
+      channelIsConstant[dst] = false;
+      return;
+    }
+    materialize(dst);
+    if (linearGain == FTYPE(1)) {
+      kernels::add(data[dst], src.samples, numSamples);
+    } else {
+      kernels::addScaled(data[dst], src.samples, numSamples, linearGain);
+    }
+  }
+
+  // rhs is an AudioBufferC or a const view
+  template <class Source>
+  AudioBufferC& mixIn(const Source& rhs, size_t rhsChannels, int numSamples, FTYPE linearGain) {
+    if (!usedChannels || !rhsChannels) {
+      return *this;
+    }
+    // other layouts (ambisonics among them) go through sum(rhs, MixingMatrixC, numSamples)
+    if (usedChannels == rhsChannels) {
+      for (size_t chan = 0; chan < usedChannels; ++chan) {
+        mixChannel(chan, getSource(rhs, chan), numSamples, linearGain);
+      }
+    } else if (usedChannels == 2 && rhsChannels == 1) {
+      mixChannel(0, getSource(rhs, 0), numSamples, linearGain);
+      mixChannel(1, getSource(rhs, 0), numSamples, linearGain);
+    } else if (usedChannels == 1 && rhsChannels == 2){
+      // the mono channel is expanded to stereo
+      assert(channels > 1);
+      copyChannel(*this, 0, 1);
+      mixChannel(1, getSource(rhs, 1), numSamples, linearGain);
+      mixChannel(0, getSource(rhs, 0), numSamples, linearGain);
+    } else {
+      assert(false && "Summing is not supported for this channel configuration, use sum(rhs, MixingMatrixC, numSamples)");
+    }
+    usedChannels = std::max(usedChannels, rhsChannels);
+    return *this;
+  }
+
+  void steal(AudioBufferC& rhs) {
+    channels = rhs.channels;
+    usedChannels = rhs.usedChannels;
+    size = rhs.size;
+    usedSize = rhs.usedSize;
+    data = rhs.data;
+    storage = rhs.storage;
+    storageCapacity = rhs.storageCapacity;
+    pointerCapacity = rhs.pointerCapacity;
+    layout = rhs.layout;
+    tailPadding = rhs.tailPadding;
+    stride = rhs.stride;
+    channelIsConstant.swap(rhs.channelIsConstant);
+    channelConstantValue.swap(rhs.channelConstantValue);
+    rhs.data = NULL;
+    rhs.storage = NULL;
+    rhs.release();
+  }
+
   FTYPE* storage;
+  size_t storageCapacity;
+  size_t pointerCapacity;
+  AudioAllocator* allocator;
+  AudioBufferLayout layout;
+  size_t tailPadding;
+  size_t stride;
   
   
   /* MATLAB 
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __AUDIOBUFFERVIEW_HPP__
+#define __AUDIOBUFFERVIEW_HPP__
+
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+#include "VectorKernels.h"
+
+namespace asu {
+
+/**
+ * A window over planar samples that belong to someone else: an AudioBufferC,
+ * a decoder, a mapped file. It's made of the caller's array of channel
+ * pointers, an offset and a length, and it's cheap to pass by value. The
+ * pointer array and the samples must outlive the view.
+ * AudioBufferViewC<const float> is the read-only variant, a mutable view
+ * converts to it implicitly.
+ */
+template <class SampleT>
+class AudioBufferViewC {
+public:
+  AudioBufferViewC() :
+    m_channels(nullptr),
+    m_numberOfChannels(0),
+    m_offset(0),
+    m_length(0) {
+  }
+
+  AudioBufferViewC(SampleT* const* channels, size_t numberOfChannels, size_t offset, size_t length) :
+    m_channels(channels),
+    m_numberOfChannels(numberOfChannels),
+    m_offset(offset),
+    m_length(length) {
+  }
+
+  template <class OtherT>
+  AudioBufferViewC(const AudioBufferViewC<OtherT>& other,
+    typename std::enable_if<std::is_convertible<OtherT*, SampleT*>::value>::type* = 0) :
+    m_channels(other.getChannelPointers()),
+    m_numberOfChannels(other.getNumberOfChannels()),
+    m_offset(other.getOffset()),
+    m_length(other.getLength()) {
+  }
+
+  size_t getNumberOfChannels() const { return m_numberOfChannels; }
+  size_t getLength() const { return m_length; }
+  size_t getOffset() const { return m_offset; }
+  SampleT* const* getChannelPointers() const { return m_channels; }
+
+  // first sample of the view in this channel
+  SampleT* getChannel(size_t channel) const {
+    assert(channel < m_numberOfChannels);
+    return m_channels[channel] + m_offset;
+  }
+
+  SampleT* operator[](size_t channel) const {
+    return getChannel(channel);
+  }
+
+  // a part of this view, offset is relative to its start
+  AudioBufferViewC getRange(size_t offset, size_t length) const {
+    assert(offset + length <= m_length);
+    return AudioBufferViewC(m_channels, m_numberOfChannels, m_offset + offset, length);
+  }
+
+private:
+  SampleT* const* m_channels;
+  size_t m_numberOfChannels;
+  size_t m_offset;
+  size_t m_length;
+};
+
+typedef AudioBufferViewC<float> AudioBufferView;
+typedef AudioBufferViewC<const float> ConstAudioBufferView;
+
+// processing on views. A mono source is used for all the channels of dst,
+// otherwise the channels must match. Only the first dst.getLength() samples
+// of src are read
+
+template <class DstT>
+inline void fill(const AudioBufferViewC<DstT>& dst, DstT value) {
+  for (size_t ch = 0; ch < dst.getNumberOfChannels(); ++ch) {
+    std::fill(dst[ch], dst[ch] + dst.getLength(), value);
+  }
+}
+
+template <class DstT>
+inline void applyGain(const AudioBufferViewC<DstT>& dst, DstT linearGain) {
+  for (size_t ch = 0; ch < dst.getNumberOfChannels(); ++ch) {
+    kernels::scale(dst[ch], dst.getLength(), linearGain);
+  }
+}
+
+template <class SrcT, class DstT>
+inline void copy(const AudioBufferViewC<SrcT>& src, const AudioBufferViewC<DstT>& dst) {
+  assert(src.getNumberOfChannels() == 1 || src.getNumberOfChannels() == dst.getNumberOfChannels());
+  assert(src.getLength() >= dst.getLength());
+  for (size_t ch = 0; ch < dst.getNumberOfChannels(); ++ch) {
+    const SrcT* in = src[src.getNumberOfChannels() == 1 ? 0 : ch];
+    std::copy(in, in + dst.getLength(), dst[ch]);
+  }
+}
+
+// dst += src * linearGain
+template <class SrcT, class DstT>
+inline void sum(const AudioBufferViewC<SrcT>& src, const AudioBufferViewC<DstT>& dst, DstT linearGain = DstT(1)) {
+  assert(src.getNumberOfChannels() == 1 || src.getNumberOfChannels() == dst.getNumberOfChannels());
+  assert(src.getLength() >= dst.getLength());
+  for (size_t ch = 0; ch < dst.getNumberOfChannels(); ++ch) {
+    const SrcT* in = src[src.getNumberOfChannels() == 1 ? 0 : ch];
+    if (linearGain == DstT(1)) {
+      kernels::add(dst[ch], in, dst.getLength());
+    } else {
+      kernels::addScaled(dst[ch], in, dst.getLength(), linearGain);
+    }
+  }
+}
+
+}
+
+#endif // __AUDIOBUFFERVIEW_HPP__
@@ -31,14 +31,109 @@
 #define Dmaf_OSC_Utilities_AudioFormat_hpp
 
 #include <vector>
+#include <memory>
+#include <string>
 #include "AudioBuffer.hpp"
 #include "AudioFormatTypes.h"
+#include "AudioInputStream.hpp"
 
 namespace asu {
 namespace assets {
 
+// Pull-style decoder handed out by AudioFormat::createReader. The file is
+// decoded a chunk at a time into a buffer owned by the caller, so the memory
+// used does not depend on the length of the file.
+class AudioFormatReader {
+public:
+  AudioFormatReader() :
+    m_samplingRate(0),
+    m_numberOfChannels(0),
+    m_length(0) {
+  }
+  virtual ~AudioFormatReader() {}
+
+  virtual bool open(const std::string& path) = 0;
+
+  // decodes from a stream instead of a file, the reader holds on to it until
+  // closed. False if the backend can only read files
+  virtual bool openStream(std::shared_ptr<AudioInputStream> stream) {
+    return false;
+  }
+
+  // decodes up to view.getLength() frames straight into the channels of view,
+  // which must have getNumberOfChannels() of them. Returns the number of
+  // frames decoded, 0 at the end of the file
+  virtual size_t readFrames(const AudioBufferView& view) = 0;
+
+  // decodes up to numFrames frames at the beginning of each channel of buffer,
+  // which is resized only if it can't hold them. Returns the number of frames
+  // decoded (also stored in buffer.usedSize), 0 at the end of the file
+  size_t readFrames(AudioBuffer& buffer, size_t numFrames) {
+    prepareBuffer(buffer, numFrames);
+    buffer.markAsWritten();
+    size_t count = readFrames(AudioBufferView(buffer.data, m_numberOfChannels, 0, numFrames));
+    buffer.usedSize = count;
+    return count;
+  }
+
+  // moves to a frame, the next readFrames starts exactly from there
+  virtual bool seek(unsigned long frame) = 0;
+
+  virtual void close() = 0;
+
+  float getSamplingRate() const { return m_samplingRate; }
+  unsigned int getNumberOfChannels() const { return m_numberOfChannels; }
+  // length in frames, 0 if it can't be known without decoding the whole file
+  unsigned long getLength() const { return m_length; }
+protected:
+  void prepareBuffer(AudioBuffer& buffer, size_t numFrames) {
+    if (buffer.channels != m_numberOfChannels || buffer.size < numFrames) {
+      buffer.resize(m_numberOfChannels, numFrames);
+    }
+  }
+  float m_samplingRate;
+  unsigned int m_numberOfChannels;
+  unsigned long m_length;
+};
+
+// Incremental encoder handed out by AudioFormat::createWriter. Frames are
+// encoded and flushed to disk as soon as they are appended, so long signals
+// can be written without holding them in memory.
+class AudioFormatWriter {
+public:
+  virtual ~AudioFormatWriter() {}
+
+  // the format specifies the type, not the extension!
+  virtual bool open(const std::string& path,
+    const float samplingRate,
+    const unsigned int numberOfChannels,
+    const AudioFormatTypes format_,
+    const void* formatDetail_ = nullptr) = 0;
+
+  // encodes all the frames of view, which must have at least as many
+  // channels as the file
+  virtual bool appendFrames(const ConstAudioBufferView& view) = 0;
+
+  // encodes numFrames frames of each channel of buffer starting at offset,
+  // the constant channels are written out first
+  bool appendFrames(AudioBuffer& buffer, size_t offset, size_t numFrames) {
+    assert(offset + numFrames <= buffer.size);
+    buffer.materialize();
+    const float* const* channels = buffer.data;
+    return appendFrames(ConstAudioBufferView(channels, buffer.usedChannels, offset, numFrames));
+  }
+
+  // flushes what is left in the encoder and closes the file
+  virtual bool finalize() = 0;
+};
+
+// One instance is shared by every thread using an AudioFormatsManager, so
+// loadFile, writeFile and the others must not modify the object: the state
+// of a call belongs to the call, or to the reader and writer it creates.
 class AudioFormat {
 public:
+  virtual ~AudioFormat() {}
+
   // pass a ptr to AudioFormat if you wanna know the format of the decoded file
   virtual bool loadFile(const std::string& path,
     AudioBuffer& buffer,
@@ -52,6 +147,41 @@ public:
     const AudioFormatTypes format_,
     const void* formatDetail_ = nullptr) = 0;
 
+  // decodes numFrames frames starting from startFrame, buffer.usedSize tells
+  // how many could actually be read. The cost depends on the range, not on the
+  // length of the file
+  virtual bool loadRange(const std::string& path,
+    unsigned long startFrame,
+    size_t numFrames,
+    AudioBuffer& buffer,
+    float& samplingRate) {
+    std::unique_ptr<AudioFormatReader> reader = createReader();
+    if (!reader || !reader->open(path)) {
+      return false;
+    }
+    if (!reader->seek(startFrame)) {
+      return false;
+    }
+    samplingRate = reader->getSamplingRate();
+    reader->readFrames(buffer, numFrames);
+    return true;
+  }
+
+  // decodes a whole stream, see AudioFormatReader::openStream
+  virtual bool loadStream(std::shared_ptr<AudioInputStream> stream,
+    AudioBuffer& buffer,
+    float& samplingRate) {
+    std::unique_ptr<AudioFormatReader> reader = createReader();
+    if (!reader || !reader->openStream(stream) || reader->getLength() == 0) {
+      return false;
+    }
+    samplingRate = reader->getSamplingRate();
+    buffer.resize(reader->getNumberOfChannels(), reader->getLength());
+    return reader->readFrames(buffer, buffer.size) > 0;
+  }
+
+  // reads the header only, without decoding. bitsPerChannel is 0 for the
+  // compressed formats
   virtual bool getFileInfo(const std::string& path,
     float& samplingRate,
     unsigned int& numberOfChannels_,
@@ -60,6 +190,19 @@ public:
     assert("Unimplemented for this format"); // todo
     return false;
   }
+
+  // returns a reader that still has to be opened, nullptr if this backend
+  // can't decode in chunks
+  virtual std::unique_ptr<AudioFormatReader> createReader() {
+    return nullptr;
+  }
+
+  // returns a writer that still has to be opened, nullptr if this backend
+  // can't encode incrementally
+  virtual std::unique_ptr<AudioFormatWriter> createWriter() {
+    return nullptr;
+  }
+
   std::vector<AudioFormatTypes>& getSupportedFormatsForReading() { return m_supportedFormatsForReading; }
   std::vector<AudioFormatTypes>& getSupportedFormatsForWriting() { return m_supportedFormatsForWriting; }
 protected:
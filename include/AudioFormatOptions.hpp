@@ -31,6 +31,7 @@
 #define Project_AudioFormatOptions_hpp
 
 #include <deque>
+#include <cstddef>
 
 namespace asu {
 namespace assets {
@@ -45,15 +46,49 @@ struct MP3Options {
 
 };
 
-struct WAVOptions {
+// how the samples of uncompressed files are encoded when writing
+struct PCMWriteOptions {
+  PCMWriteOptions() :
+    bitsPerSample(16),
+    isFloat(false),
+    dither(false),
+    blockSize(16384) {}
+  // 16, 24 or 32, floats are always 32
+  unsigned int bitsPerSample;
+  bool isFloat;
+  // triangular dither when going down to 16 or 24 bits
+  bool dither;
+  // frames converted and handed to the library at a time
+  size_t blockSize;
+};
+
+struct WAVOptions : public PCMWriteOptions {
 
 
 };
 
-struct AIFFOptions {
+struct AIFFOptions : public PCMWriteOptions {
   std::deque<unsigned long> markers;
 };
 
+// RAW files have no header, this describes how the samples are laid out
+struct RAWOptions {
+  RAWOptions() :
+    samplingRate(44100.F),
+    numberOfChannels(2),
+    bitsPerSample(16),
+    isFloat(false),
+    bigEndian(false),
+    headerSize(0) {}
+  float samplingRate;
+  unsigned int numberOfChannels;
+  unsigned int bitsPerSample;
+  bool isFloat;
+  bool bigEndian;
+  // bytes to skip at the beginning of the file
+  size_t headerSize;
+};
+
 }
 }
 
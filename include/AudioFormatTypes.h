@@ -118,6 +118,84 @@ inline AudioFormatTypes extensionToAudioFormat(const char* extension_) {
   }
 }
 
+// Size of the ID3v2 tag at the start of the header (its 10 bytes header
+// included), 0 if there is none
+inline size_t id3TagSize(const unsigned char* header_, size_t size_) {
+  if (size_ < 10 || memcmp(header_, "ID3", 3) != 0) {
+    return 0;
+  }
+  // synchsafe integer, 7 bits per byte
+  size_t tagSize = ((size_t)(header_[6] & 0x7F) << 21) | ((size_t)(header_[7] & 0x7F) << 14) |
+    ((size_t)(header_[8] & 0x7F) << 7) | (size_t)(header_[9] & 0x7F);
+  // footer
+  if (header_[5] & 0x10) {
+    tagSize += 10;
+  }
+  return tagSize + 10;
+}
+
+// Guesses the format from the first bytes of a file, a few hundred are
+// enough. Returns ASU_FORMAT_UNKNOWN when nothing matches: RAW files have no
+// header and can only be recognized from the extension.
+inline AudioFormatTypes probeAudioFormat(const unsigned char* header_, size_t size_) {
+  if (size_ >= 12) {
+    if ((memcmp(header_, "RIFF", 4) == 0 || memcmp(header_, "RIFX", 4) == 0 || memcmp(header_, "RF64", 4) == 0) &&
+        memcmp(header_ + 8, "WAVE", 4) == 0) {
+      return ASU_FORMAT_WAV;
+    }
+    if (memcmp(header_, "FORM", 4) == 0 &&
+        (memcmp(header_ + 8, "AIFF", 4) == 0 || memcmp(header_ + 8, "AIFC", 4) == 0)) {
+      return ASU_FORMAT_AIFF;
+    }
+  }
+  if (size_ >= 4 && memcmp(header_, "OggS", 4) == 0) {
+    return ASU_FORMAT_OGG;
+  }
+  size_t tagSize = id3TagSize(header_, size_);
+  if (tagSize > 0) {
+    if (tagSize + 4 > size_) {
+      // the frames are past the header, almost always mp3
+      return ASU_FORMAT_MP3;
+    }
+    AudioFormatTypes afterTag = probeAudioFormat(header_ + tagSize, size_ - tagSize);
+    return afterTag == ASU_FORMAT_UNKNOWN ? ASU_FORMAT_MP3 : afterTag;
+  }
+  if (size_ >= 4 && header_[0] == 0xFF) {
+    // ADTS: 12 bits of sync and the layer always 0
+    if ((header_[1] & 0xF6) == 0xF0 && ((header_[2] >> 2) & 0x0F) < 13) {
+      return ASU_FORMAT_AAC;
+    }
+    // MPEG audio: 11 bits of sync, a layer, a valid bitrate and sampling rate
+    if ((header_[1] & 0xE0) == 0xE0 && (header_[1] & 0x18) != 0x08 && (header_[1] & 0x06) != 0 &&
+        (header_[2] >> 4) != 0x0F && ((header_[2] >> 2) & 0x03) != 0x03) {
+      return ASU_FORMAT_MP3;
+    }
+  }
+  return ASU_FORMAT_UNKNOWN;
+}
+
+// True when the header starts with a container or tag magic. Frame syncs are
+// only a few bits and raw samples (-1 in 16 bit is 0xFFFF) match them often,
+// so they are not enough to contradict the extension.
+inline bool hasAudioFormatMagic(const unsigned char* header_, size_t size_) {
+  if (id3TagSize(header_, size_) > 0 || (size_ >= 4 && memcmp(header_, "OggS", 4) == 0)) {
+    return true;
+  }
+  // RIFF and FORM alone may be any other kind of file
+  AudioFormatTypes format = probeAudioFormat(header_, size_);
+  return format == ASU_FORMAT_WAV || format == ASU_FORMAT_AIFF;
+}
+
+// The format from the first bytes and the one suggested by the extension: a
+// magic always wins, a frame sync only when the extension says nothing
+inline AudioFormatTypes probeAudioFormat(const unsigned char* header_, size_t size_, AudioFormatTypes hint_) {
+  AudioFormatTypes format = probeAudioFormat(header_, size_);
+  if (format == ASU_FORMAT_UNKNOWN || (hint_ != ASU_FORMAT_UNKNOWN && !hasAudioFormatMagic(header_, size_))) {
+    return hint_;
+  }
+  return format;
+}
+
 }
 }
 
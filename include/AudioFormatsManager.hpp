@@ -30,17 +30,52 @@
 #ifndef __AudioFormatsManager__
 #define __AudioFormatsManager__
 
+#include <list>
 #include <map>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "AudioFormat.hpp"
 #include "AudioFormatTypes.h"
+#include "AudioFormatOptions.hpp"
 
 namespace asu {
 namespace assets {
   
+struct AudioFileInfo {
+  AudioFileInfo() :
+    valid(false),
+    format(ASU_FORMAT_UNKNOWN),
+    samplingRate(0),
+    numberOfChannels(0),
+    bitsPerChannel(0),
+    length(0) {}
+  std::string path;
+  // false if the file could not be read
+  bool valid;
+  AudioFormatTypes format;
+  float samplingRate;
+  unsigned int numberOfChannels;
+  unsigned int bitsPerChannel;
+  unsigned long length;
+};
+
+// More than one decoder can be registered for a format: they are tried in the
+// order they have been added, until one of them accepts the file.
+//
+// One instance can be used from any number of threads at the same time: the
+// decoders are registered in the constructor and never change, the backends
+// keep the state of each call on the stack, in its reader or writer, or in
+// per-thread scratch memory, and the probe cache is locked.
+//
+// The probe cache keeps the formats of the kProbeCacheSize files probed most
+// recently, so a long running process sharing one instance across any number
+// of files doesn't grow with them.
 class AudioFormatsManager {
 public:
+  static const size_t kProbeCacheSize = 4096;
+
   AudioFormatsManager();
   
   bool loadFile(const std::string& path,
@@ -48,6 +83,14 @@ public:
     float& samplingRate,
     void** formatDetail_ = NULL);
 
+  bool loadRange(const std::string& path,
+    unsigned long startFrame,
+    size_t numFrames,
+    AudioBuffer& buffer,
+    float& samplingRate);
+
+  // formatDetail_ points to the options of the format, WAVOptions for
+  // ASU_FORMAT_WAV and so on, nullptr means the defaults
   bool writeFile(const std::string& path,
     AudioBuffer& buffer,
     const float samplingRate,
@@ -60,12 +103,74 @@ public:
     unsigned int& numberOfChannels_,
     unsigned int& bitsPerChannel,
     unsigned long& length);
+
+  // the info of many files, read from their headers by numberOfThreads
+  // threads, 0 for one per core. The results are in the order of the paths
+  std::vector<AudioFileInfo> getFileInfo(const std::vector<std::string>& paths,
+    unsigned int numberOfThreads = 0);
+
+  // decodes from memory or any other stream instead of a file. The format
+  // comes from the content, format_ is only used if it is not recognized
+  bool loadStream(std::shared_ptr<AudioInputStream> stream,
+    AudioBuffer& buffer,
+    float& samplingRate,
+    const AudioFormatTypes format_ = ASU_FORMAT_UNKNOWN);
+
+  // data is not copied, it only has to be valid until the function returns
+  bool loadMemory(const void* data,
+    size_t size,
+    AudioBuffer& buffer,
+    float& samplingRate,
+    const AudioFormatTypes format_ = ASU_FORMAT_UNKNOWN);
+
+  // opens a file to be decoded in chunks with AudioFormatReader::readFrames,
+  // returns nullptr if the file can't be opened or the backend can't stream
+  std::unique_ptr<AudioFormatReader> openFile(const std::string& path);
+
+  // same as above on a stream, the reader keeps a reference to it
+  std::unique_ptr<AudioFormatReader> openStream(std::shared_ptr<AudioInputStream> stream,
+    const AudioFormatTypes format_ = ASU_FORMAT_UNKNOWN);
+
+  // creates a file to be encoded incrementally with AudioFormatWriter::appendFrames,
+  // returns nullptr if the file can't be created or the backend can't stream
+  std::unique_ptr<AudioFormatWriter> createFile(const std::string& path,
+    const float samplingRate,
+    const unsigned int numberOfChannels,
+    const AudioFormatTypes format_,
+    const void* formatDetail_ = nullptr);
+
+  // layout assumed for the RAW files, which have no header
+  void setRawOptions(const RAWOptions& options_);
+
+  // the format of the file from its first bytes. The extension is used when
+  // they are not recognized (RAW files) or only match a frame sync, which
+  // raw samples often do. The result is cached until the file is modified.
+  AudioFormatTypes probeFile(const std::string& path);
+
+  // forgets the formats probed so far, they are read again from the files
+  void clearProbeCache();
   
 private:
+  typedef std::vector<std::shared_ptr<AudioFormat> > DecoderList;
+
+  struct ProbeResult {
+    AudioFormatTypes format;
+    long long size;
+    long long modified;
+    // where the path is in m_probeOrder
+    std::list<std::string>::iterator recent;
+  };
+
   void addFormat(std::shared_ptr<AudioFormat> fmt);
+  const DecoderList* decodersForFile(const std::string& path);
+  const DecoderList* decodersForStream(AudioInputStream& stream, AudioFormatTypes hint);
 
-  std::map<AudioFormatTypes, std::shared_ptr<AudioFormat> > m_formatsForReading;
+  std::map<AudioFormatTypes, DecoderList> m_formatsForReading;
   std::map<AudioFormatTypes, std::shared_ptr<AudioFormat> > m_formatsForWriting;
+  std::map<std::string, ProbeResult> m_probeCache;
+  // the cached paths, the most recently used first
+  std::list<std::string> m_probeOrder;
+  std::mutex m_probeMutex;
 };
   
 }}
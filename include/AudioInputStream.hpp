@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __AudioInputStream__
+#define __AudioInputStream__
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "UtilityClasses.h"
+
+namespace asu {
+namespace assets {
+
+/**
+ * Bytes of an encoded file, wherever they come from. The decoders read
+ * through it instead of opening a path, so assets that are already in memory
+ * don't have to go through a temporary file. Implement it to decode from
+ * archives, caches or network buffers.
+ */
+class AudioInputStream {
+public:
+  virtual ~AudioInputStream() {}
+
+  // reads up to bytes bytes, returns how many were read, 0 at the end
+  virtual size_t read(void* destination, size_t bytes) = 0;
+
+  // moves to an absolute position in bytes
+  virtual bool seek(unsigned long long position) = 0;
+
+  virtual unsigned long long tell() = 0;
+
+  // total size in bytes
+  virtual unsigned long long getLength() = 0;
+
+  // the whole content if it is already in memory, so that the backends that
+  // need it in one piece don't copy it
+  virtual const void* getData() { return nullptr; }
+};
+
+// A span of memory, either owned by the caller, who has to keep it alive
+// while decoding, or moved into the stream. Not copyable: a copy of an owning
+// stream would point into the bytes of the original
+class MemoryInputStream : public AudioInputStream, public utilities::noncopyable {
+public:
+  MemoryInputStream(const void* data_, size_t size_) :
+    m_data((const unsigned char*)data_),
+    m_size(size_),
+    m_position(0) {
+  }
+
+  MemoryInputStream(std::vector<unsigned char>&& bytes_) :
+    m_owned(std::move(bytes_)),
+    m_data(m_owned.data()),
+    m_size(m_owned.size()),
+    m_position(0) {
+  }
+
+  size_t read(void* destination, size_t bytes) {
+    size_t count = std::min(bytes, m_size - m_position);
+    if (count > 0) {
+      memcpy(destination, m_data + m_position, count);
+    }
+    m_position += count;
+    return count;
+  }
+
+  bool seek(unsigned long long position) {
+    if (position > m_size) {
+      return false;
+    }
+    m_position = (size_t)position;
+    return true;
+  }
+
+  unsigned long long tell() { return m_position; }
+  unsigned long long getLength() { return m_size; }
+  const void* getData() { return m_data; }
+private:
+  std::vector<unsigned char> m_owned;
+  const unsigned char* m_data;
+  size_t m_size;
+  size_t m_position;
+};
+
+class FileInputStream : public AudioInputStream, public utilities::noncopyable {
+public:
+  FileInputStream() : m_file(NULL), m_length(0) {}
+  ~FileInputStream() { close(); }
+
+  bool open(const std::string& path) {
+    close();
+    m_file = fopen(path.c_str(), "rb");
+    if (m_file == NULL) {
+      return false;
+    }
+    // the decoders hop between small headers, a bigger buffer saves system calls
+    setvbuf(m_file, NULL, _IOFBF, 1 << 16);
+    fseek(m_file, 0, SEEK_END);
+    m_length = ftell(m_file);
+    fseek(m_file, 0, SEEK_SET);
+    return true;
+  }
+
+  void close() {
+    if (m_file != NULL) {
+      fclose(m_file);
+      m_file = NULL;
+    }
+    m_length = 0;
+  }
+
+  size_t read(void* destination, size_t bytes) {
+    return m_file != NULL ? fread(destination, 1, bytes, m_file) : 0;
+  }
+
+  bool seek(unsigned long long position) {
+    return m_file != NULL && fseek(m_file, (long)position, SEEK_SET) == 0;
+  }
+
+  unsigned long long tell() { return m_file != NULL ? ftell(m_file) : 0; }
+  unsigned long long getLength() { return m_length; }
+private:
+  FILE* m_file;
+  unsigned long long m_length;
+};
+
+// the content of the stream in one piece: its own memory if it has some,
+// otherwise everything from the beginning is read into storage
+inline const void* getStreamData(AudioInputStream& stream, std::vector<unsigned char>& storage) {
+  if (stream.getData() != nullptr) {
+    return stream.getData();
+  }
+  storage.resize((size_t)stream.getLength());
+  if (!stream.seek(0) || stream.read(storage.data(), storage.size()) != storage.size()) {
+    storage.clear();
+    return nullptr;
+  }
+  return storage.data();
+}
+
+}
+}
+
+#endif /* defined(__AudioInputStream__) */
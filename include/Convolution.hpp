@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __CONVOLUTION_HPP__
+#define __CONVOLUTION_HPP__
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "FFT.hpp"
+#include "AudioBufferView.hpp"
+
+namespace asu {
+
+/**
+ * Uniformly partitioned overlap-save convolution. The impulse response is
+ * cut in partitions of blockSize samples, each one kept as a spectrum of a
+ * 2 * blockSize FFT; the spectra of the last input blocks go through a
+ * frequency domain delay line, so every block costs one forward and one
+ * inverse FFT plus a multiply-accumulate per partition. Output blocks come
+ * out with no latency.
+ * Input channels without an impulse channel of their own use the first one,
+ * like AudioBufferC::convolveTd.
+ */
+template <class FTYPE>
+class ConvolverC {
+public:
+  ConvolverC() :
+    m_blockSize(0),
+    m_numberOfBins(0),
+    m_numberOfPartitions(0),
+    m_numberOfChannels(0),
+    m_delayLinePosition(0) {
+  }
+
+  // false if blockSize isn't a power of two or there is no impulse
+  bool init(const AudioBufferViewC<const FTYPE>& impulse, size_t numberOfChannels, size_t blockSize) {
+    if (impulse.getNumberOfChannels() == 0 || impulse.getLength() == 0 || numberOfChannels == 0 ||
+        !m_fft.init(2 * blockSize)) {
+      return false;
+    }
+    m_blockSize = blockSize;
+    m_numberOfBins = m_fft.getNumberOfBins();
+    m_numberOfPartitions = (impulse.getLength() + blockSize - 1) / blockSize;
+    m_numberOfChannels = numberOfChannels;
+    const size_t spectrumSize = m_numberOfPartitions * m_numberOfBins;
+    const size_t impulseChannels = std::min(impulse.getNumberOfChannels(), numberOfChannels);
+    m_impulseRe.assign(impulseChannels, std::vector<FTYPE>(spectrumSize));
+    m_impulseIm.assign(impulseChannels, std::vector<FTYPE>(spectrumSize));
+    m_time.assign(2 * blockSize, FTYPE(0));
+    for (size_t ch = 0; ch < impulseChannels; ++ch) {
+      for (size_t p = 0; p < m_numberOfPartitions; ++p) {
+        const size_t start = p * blockSize;
+        const size_t count = std::min(blockSize, impulse.getLength() - start);
+        std::copy(impulse[ch] + start, impulse[ch] + start + count, m_time.begin());
+        std::fill(m_time.begin() + count, m_time.end(), FTYPE(0));
+        m_fft.forward(&m_time[0], &m_impulseRe[ch][p * m_numberOfBins], &m_impulseIm[ch][p * m_numberOfBins]);
+      }
+    }
+    m_input.assign(numberOfChannels, std::vector<FTYPE>(2 * blockSize));
+    m_delayLineRe.assign(numberOfChannels, std::vector<FTYPE>(spectrumSize));
+    m_delayLineIm.assign(numberOfChannels, std::vector<FTYPE>(spectrumSize));
+    m_accumulatorRe.resize(m_numberOfBins);
+    m_accumulatorIm.resize(m_numberOfBins);
+    reset();
+    return true;
+  }
+
+  // clears the history, as if only silence was processed so far
+  void reset() {
+    for (size_t ch = 0; ch < m_numberOfChannels; ++ch) {
+      std::fill(m_input[ch].begin(), m_input[ch].end(), FTYPE(0));
+      std::fill(m_delayLineRe[ch].begin(), m_delayLineRe[ch].end(), FTYPE(0));
+      std::fill(m_delayLineIm[ch].begin(), m_delayLineIm[ch].end(), FTYPE(0));
+    }
+    m_delayLinePosition = 0;
+  }
+
+  size_t getBlockSize() const { return m_blockSize; }
+  size_t getNumberOfChannels() const { return m_numberOfChannels; }
+  size_t getNumberOfPartitions() const { return m_numberOfPartitions; }
+
+  // convolves exactly getBlockSize() frames. input and output may be the same samples
+  void process(const AudioBufferViewC<const FTYPE>& input, const AudioBufferViewC<FTYPE>& output) {
+    assert(input.getNumberOfChannels() >= m_numberOfChannels && output.getNumberOfChannels() >= m_numberOfChannels);
+    assert(input.getLength() == m_blockSize && output.getLength() == m_blockSize);
+    for (size_t ch = 0; ch < m_numberOfChannels; ++ch) {
+      std::vector<FTYPE>& window = m_input[ch];
+      // the previous block slides in the first half, the new one in the second
+      std::copy(window.begin() + m_blockSize, window.end(), window.begin());
+      std::copy(input[ch], input[ch] + m_blockSize, window.begin() + m_blockSize);
+      const size_t slot = m_delayLinePosition * m_numberOfBins;
+      m_fft.forward(&window[0], &m_delayLineRe[ch][slot], &m_delayLineIm[ch][slot]);
+
+      const size_t impulseChannel = ch < m_impulseRe.size() ? ch : 0;
+      std::fill(m_accumulatorRe.begin(), m_accumulatorRe.end(), FTYPE(0));
+      std::fill(m_accumulatorIm.begin(), m_accumulatorIm.end(), FTYPE(0));
+      // partition p meets the input of p blocks ago
+      size_t position = m_delayLinePosition;
+      for (size_t p = 0; p < m_numberOfPartitions; ++p) {
+        multiplyAccumulate(&m_delayLineRe[ch][position * m_numberOfBins], &m_delayLineIm[ch][position * m_numberOfBins],
+          &m_impulseRe[impulseChannel][p * m_numberOfBins], &m_impulseIm[impulseChannel][p * m_numberOfBins]);
+        position = position == 0 ? m_numberOfPartitions - 1 : position - 1;
+      }
+      m_fft.inverse(&m_accumulatorRe[0], &m_accumulatorIm[0], &m_time[0]);
+      // the first half is aliased by the circular convolution
+      std::copy(m_time.begin() + m_blockSize, m_time.end(), output[ch]);
+    }
+    m_delayLinePosition = (m_delayLinePosition + 1) % m_numberOfPartitions;
+  }
+
+  // Partitions that make one-shot convolutions of long responses fast: few
+  // enough that the multiply-accumulate doesn't dominate the FFTs
+  static size_t getDefaultBlockSize(size_t impulseLength) {
+    size_t blockSize = 64;
+    while (blockSize < 16384 && blockSize * 16 < impulseLength) {
+      blockSize <<= 1;
+    }
+    return blockSize;
+  }
+
+private:
+  void multiplyAccumulate(const FTYPE* xRe, const FTYPE* xIm, const FTYPE* hRe, const FTYPE* hIm) {
+    FTYPE* accRe = &m_accumulatorRe[0];
+    FTYPE* accIm = &m_accumulatorIm[0];
+    for (size_t k = 0; k < m_numberOfBins; ++k) {
+      accRe[k] += xRe[k] * hRe[k] - xIm[k] * hIm[k];
+      accIm[k] += xRe[k] * hIm[k] + xIm[k] * hRe[k];
+    }
+  }
+
+  RealFFTC<FTYPE> m_fft;
+  size_t m_blockSize;
+  size_t m_numberOfBins;
+  size_t m_numberOfPartitions;
+  size_t m_numberOfChannels;
+  size_t m_delayLinePosition;
+  // the spectra of the partitions, for each impulse channel
+  std::vector<std::vector<FTYPE> > m_impulseRe;
+  std::vector<std::vector<FTYPE> > m_impulseIm;
+  // the spectra of the last m_numberOfPartitions input blocks, for each channel
+  std::vector<std::vector<FTYPE> > m_delayLineRe;
+  std::vector<std::vector<FTYPE> > m_delayLineIm;
+  std::vector<std::vector<FTYPE> > m_input;
+  std::vector<FTYPE> m_accumulatorRe;
+  std::vector<FTYPE> m_accumulatorIm;
+  std::vector<FTYPE> m_time;
+};
+
+typedef ConvolverC<float> Convolver;
+
+}
+
+#endif // __CONVOLUTION_HPP__
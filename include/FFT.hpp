@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __FFT_HPP__
+#define __FFT_HPP__
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstddef>
+
+namespace asu {
+
+/**
+ * Radix-2 FFT of real signals, for power of two sizes. The real input of
+ * length N is packed in a complex signal of length N/2, transformed in place
+ * and split back into the N/2 + 1 bins of the real spectrum. Spectra are kept
+ * with the real and the imaginary parts in two arrays, which is what the
+ * convolution loops want. The tables are built once in init, forward and
+ * inverse don't allocate.
+ */
+template <class FTYPE>
+class RealFFTC {
+public:
+  RealFFTC() : m_size(0), m_half(0) {}
+
+  explicit RealFFTC(size_t size) : m_size(0), m_half(0) {
+    init(size);
+  }
+
+  // false if size isn't a power of two of at least 4
+  bool init(size_t size) {
+    if (size < 4 || (size & (size - 1)) != 0) {
+      return false;
+    }
+    m_size = size;
+    m_half = size / 2;
+    size_t bits = 0;
+    while (((size_t)1 << bits) < m_half) {
+      ++bits;
+    }
+    m_bitReverse.resize(m_half);
+    for (size_t i = 0; i < m_half; ++i) {
+      size_t reversed = 0;
+      for (size_t b = 0; b < bits; ++b) {
+        reversed |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      m_bitReverse[i] = reversed;
+    }
+    // twiddles of the half size complex transform, and of the split
+    m_cos.resize(m_half / 2 + 1);
+    m_sin.resize(m_half / 2 + 1);
+    for (size_t i = 0; i < m_cos.size(); ++i) {
+      m_cos[i] = (FTYPE)std::cos(2. * M_PI * i / m_half);
+      m_sin[i] = (FTYPE)std::sin(2. * M_PI * i / m_half);
+    }
+    m_splitCos.resize(m_half + 1);
+    m_splitSin.resize(m_half + 1);
+    for (size_t i = 0; i <= m_half; ++i) {
+      m_splitCos[i] = (FTYPE)std::cos(2. * M_PI * i / m_size);
+      m_splitSin[i] = (FTYPE)std::sin(2. * M_PI * i / m_size);
+    }
+    m_re.resize(m_half);
+    m_im.resize(m_half);
+    return true;
+  }
+
+  size_t getSize() const { return m_size; }
+  size_t getNumberOfBins() const { return m_half + 1; }
+
+  // getSize() samples to getNumberOfBins() bins, not scaled
+  void forward(const FTYPE* input, FTYPE* re, FTYPE* im) {
+    assert(m_size > 0);
+    for (size_t n = 0; n < m_half; ++n) {
+      m_re[m_bitReverse[n]] = input[2 * n];
+      m_im[m_bitReverse[n]] = input[2 * n + 1];
+    }
+    transform(false);
+    // the spectra of the even and the odd samples, recombined
+    for (size_t k = 0; k <= m_half; ++k) {
+      const size_t a = k == m_half ? 0 : k;
+      const size_t b = k == 0 ? 0 : m_half - k;
+      const FTYPE evenRe = (m_re[a] + m_re[b]) * FTYPE(.5);
+      const FTYPE evenIm = (m_im[a] - m_im[b]) * FTYPE(.5);
+      const FTYPE oddRe = (m_im[a] + m_im[b]) * FTYPE(.5);
+      const FTYPE oddIm = (m_re[b] - m_re[a]) * FTYPE(.5);
+      const FTYPE wr = m_splitCos[k], wi = -m_splitSin[k];
+      re[k] = evenRe + wr * oddRe - wi * oddIm;
+      im[k] = evenIm + wr * oddIm + wi * oddRe;
+    }
+  }
+
+  // getNumberOfBins() bins back to getSize() samples, scaled by 1 / getSize()
+  // so that inverse(forward(x)) is x
+  void inverse(const FTYPE* re, const FTYPE* im, FTYPE* output) {
+    assert(m_size > 0);
+    for (size_t k = 0; k < m_half; ++k) {
+      const FTYPE evenRe = re[k] + re[m_half - k];
+      const FTYPE evenIm = im[k] - im[m_half - k];
+      const FTYPE diffRe = re[k] - re[m_half - k];
+      const FTYPE diffIm = im[k] + im[m_half - k];
+      const FTYPE wr = m_splitCos[k], wi = m_splitSin[k];
+      const FTYPE oddRe = diffRe * wr - diffIm * wi;
+      const FTYPE oddIm = diffRe * wi + diffIm * wr;
+      const size_t j = m_bitReverse[k];
+      m_re[j] = evenRe - oddIm;
+      m_im[j] = evenIm + oddRe;
+    }
+    transform(true);
+    const FTYPE scale = FTYPE(.5) / m_half;
+    for (size_t n = 0; n < m_half; ++n) {
+      output[2 * n] = m_re[n] * scale;
+      output[2 * n + 1] = m_im[n] * scale;
+    }
+  }
+
+private:
+  // in place complex transform of m_re, m_im, already in bit reversed order
+  void transform(bool inverse) {
+    const FTYPE sign = inverse ? FTYPE(1) : FTYPE(-1);
+    FTYPE* re = &m_re[0];
+    FTYPE* im = &m_im[0];
+    for (size_t length = 2; length <= m_half; length <<= 1) {
+      const size_t halfLength = length / 2;
+      const size_t step = m_half / length;
+      for (size_t start = 0; start < m_half; start += length) {
+        for (size_t j = 0; j < halfLength; ++j) {
+          const FTYPE wr = m_cos[j * step], wi = sign * m_sin[j * step];
+          const size_t p = start + j, q = p + halfLength;
+          const FTYPE tr = re[q] * wr - im[q] * wi;
+          const FTYPE ti = re[q] * wi + im[q] * wr;
+          re[q] = re[p] - tr;
+          im[q] = im[p] - ti;
+          re[p] += tr;
+          im[p] += ti;
+        }
+      }
+    }
+  }
+
+  size_t m_size;
+  size_t m_half;
+  std::vector<size_t> m_bitReverse;
+  std::vector<FTYPE> m_cos;
+  std::vector<FTYPE> m_sin;
+  std::vector<FTYPE> m_splitCos;
+  std::vector<FTYPE> m_splitSin;
+  std::vector<FTYPE> m_re;
+  std::vector<FTYPE> m_im;
+};
+
+typedef RealFFTC<float> RealFFT;
+
+}
+
+#endif // __FFT_HPP__
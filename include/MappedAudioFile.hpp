@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __MappedAudioFile__
+#define __MappedAudioFile__
+
+#include <string>
+#include "AudioBuffer.hpp"
+#include "AudioFormatTypes.h"
+#include "AudioFormatOptions.hpp"
+#include "UtilityClasses.h"
+
+namespace asu {
+namespace assets {
+
+enum PcmSampleFormat {
+  ASU_PCM_U8,
+  ASU_PCM_S8,
+  ASU_PCM_S16,
+  ASU_PCM_S24,
+  ASU_PCM_S32,
+  ASU_PCM_FLOAT32,
+  ASU_PCM_FLOAT64
+};
+
+/**
+ * Maps an uncompressed WAV, AIFF or RAW file in memory. The samples can be
+ * accessed in place through getInterleavedData, without any copy, or
+ * converted to planar float with readFrames. The pages are shared with the
+ * page cache, so mapping the same file many times costs no extra memory.
+ */
+class MappedAudioFile : public utilities::noncopyable {
+public:
+  MappedAudioFile();
+  ~MappedAudioFile();
+
+  // RAW files have no header, their layout is given by rawOptions_
+  bool open(const std::string& path, const RAWOptions& rawOptions_ = RAWOptions());
+
+  // same as above on a WAV or AIFF file that is already in memory, which
+  // must outlive this object
+  bool open(const void* data, size_t size);
+  void close();
+  bool isOpen() const { return m_mapping != nullptr; }
+
+  AudioFormatTypes getFormat() const { return m_format; }
+  float getSamplingRate() const { return m_samplingRate; }
+  unsigned int getNumberOfChannels() const { return m_numberOfChannels; }
+  unsigned int getBitsPerSample() const { return m_bitsPerSample; }
+  PcmSampleFormat getSampleFormat() const { return m_sampleFormat; }
+  bool isBigEndian() const { return m_bigEndian; }
+  unsigned long getLength() const { return m_length; }
+
+  // zero-copy view of the interleaved samples as they are stored in the file
+  const void* getInterleavedData() const { return m_data; }
+  size_t getBytesPerFrame() const { return m_bytesPerFrame; }
+
+  // converts numFrames frames starting at startFrame to float, writing them at
+  // the beginning of each of the planar channels. Returns the frames converted
+  size_t convertFrames(float* const* channels, unsigned long startFrame, size_t numFrames) const;
+
+  // same as above, the buffer is resized only if it can't hold the frames
+  size_t readFrames(AudioBuffer& buffer, unsigned long startFrame, size_t numFrames) const;
+
+private:
+  bool parse(bool isRaw, const RAWOptions& rawOptions_);
+  bool parseWav();
+  bool parseAiff();
+  bool parseRaw(const RAWOptions& rawOptions_);
+
+  void* m_mapping;
+  size_t m_mappingSize;
+  // false when the memory belongs to the caller
+  bool m_ownsMapping;
+  const unsigned char* m_data;
+  AudioFormatTypes m_format;
+  float m_samplingRate;
+  unsigned int m_numberOfChannels;
+  unsigned int m_bitsPerSample;
+  PcmSampleFormat m_sampleFormat;
+  bool m_bigEndian;
+  size_t m_bytesPerFrame;
+  unsigned long m_length;
+};
+
+}
+}
+
+#endif /* defined(__MappedAudioFile__) */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __MIXINGMATRIX_HPP__
+#define __MIXINGMATRIX_HPP__
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+
+namespace asu {
+
+/**
+ * Gains from M input channels to N output channels, used by AudioBufferC::sum
+ * to mix buffers with different layouts. Besides the gains, the matrix keeps
+ * for every output the list of the inputs that actually reach it, so that
+ * mixing never touches the channels routed with a gain of zero.
+ */
+template <class FTYPE>
+class MixingMatrixC {
+public:
+  struct Route {
+    size_t input;
+    FTYPE gain;
+  };
+
+  MixingMatrixC(size_t numberOfInputs, size_t numberOfOutputs) :
+    m_numberOfInputs(numberOfInputs),
+    m_numberOfOutputs(numberOfOutputs),
+    m_gains(numberOfInputs * numberOfOutputs, FTYPE(0)),
+    m_routes(numberOfOutputs) {
+  }
+
+  size_t getNumberOfInputs() const { return m_numberOfInputs; }
+  size_t getNumberOfOutputs() const { return m_numberOfOutputs; }
+
+  FTYPE getGain(size_t output, size_t input) const {
+    assert(output < m_numberOfOutputs && input < m_numberOfInputs);
+    return m_gains[output * m_numberOfInputs + input];
+  }
+
+  void setGain(size_t output, size_t input, FTYPE gain) {
+    assert(output < m_numberOfOutputs && input < m_numberOfInputs);
+    m_gains[output * m_numberOfInputs + input] = gain;
+    std::vector<Route>& routes = m_routes[output];
+    routes.clear();
+    for (size_t i = 0; i < m_numberOfInputs; ++i) {
+      FTYPE g = m_gains[output * m_numberOfInputs + i];
+      if (g != FTYPE(0)) {
+        Route route = { i, g };
+        routes.push_back(route);
+      }
+    }
+  }
+
+  // the inputs with a non zero gain for this output
+  const std::vector<Route>& getRoutes(size_t output) const {
+    return m_routes[output];
+  }
+
+  static MixingMatrixC identity(size_t numberOfChannels) {
+    MixingMatrixC matrix(numberOfChannels, numberOfChannels);
+    for (size_t ch = 0; ch < numberOfChannels; ++ch) {
+      matrix.setGain(ch, ch, FTYPE(1));
+    }
+    return matrix;
+  }
+
+  // same as AudioBufferC::sum, the mono channel goes to both sides
+  static MixingMatrixC monoToStereo() {
+    MixingMatrixC matrix(1, 2);
+    matrix.setGain(0, 0, FTYPE(1));
+    matrix.setGain(1, 0, FTYPE(1));
+    return matrix;
+  }
+
+  // same as AudioBufferC::convertToMono
+  static MixingMatrixC stereoToMono() {
+    MixingMatrixC matrix(2, 1);
+    matrix.setGain(0, 0, FTYPE(.5));
+    matrix.setGain(0, 1, FTYPE(.5));
+    return matrix;
+  }
+
+  // ITU-R BS.775 downmix, inputs in the WAV order L R C LFE Ls Rs. The LFE is
+  // dropped unless lfeGain is given
+  static MixingMatrixC surround51ToStereo(FTYPE lfeGain = FTYPE(0)) {
+    const FTYPE minus3dB = FTYPE(0.70710678118654752);
+    MixingMatrixC matrix(6, 2);
+    matrix.setGain(0, 0, FTYPE(1));
+    matrix.setGain(1, 1, FTYPE(1));
+    matrix.setGain(0, 2, minus3dB);
+    matrix.setGain(1, 2, minus3dB);
+    matrix.setGain(0, 3, lfeGain);
+    matrix.setGain(1, 3, lfeGain);
+    matrix.setGain(0, 4, minus3dB);
+    matrix.setGain(1, 5, minus3dB);
+    return matrix;
+  }
+
+  // first order ambisonics in the ACN/SN3D order W Y Z X, decoded to two
+  // virtual cardioids pointing at +-angleDegrees from the front
+  static MixingMatrixC ambisonicsToStereo(FTYPE angleDegrees = FTYPE(90)) {
+    const FTYPE angle = angleDegrees * FTYPE(M_PI / 180.);
+    // at 90 degrees X must not be routed at all, not with a rounding error
+    FTYPE front = std::cos(angle);
+    if (std::fabs(front) < FTYPE(1e-6)) front = FTYPE(0);
+    MixingMatrixC matrix(4, 2);
+    for (size_t side = 0; side < 2; ++side) {
+      FTYPE sign = side == 0 ? FTYPE(1) : FTYPE(-1);
+      matrix.setGain(side, 0, FTYPE(.5));
+      matrix.setGain(side, 1, FTYPE(.5) * sign * std::sin(angle));
+      matrix.setGain(side, 3, FTYPE(.5) * front);
+    }
+    return matrix;
+  }
+
+private:
+  size_t m_numberOfInputs;
+  size_t m_numberOfOutputs;
+  std::vector<FTYPE> m_gains;
+  std::vector<std::vector<Route> > m_routes;
+};
+
+typedef MixingMatrixC<float> MixingMatrix;
+
+}
+
+#endif // __MIXINGMATRIX_HPP__
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __NOISE_HPP__
+#define __NOISE_HPP__
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <atomic>
+
+namespace asu {
+
+/**
+ * Noise from kLanes interleaved xoshiro128+ generators. A batch of kLanes
+ * values only takes shifts, xors and adds over arrays, so the compiler turns
+ * it into vector code. The lanes are seeded from (seed, stream) with
+ * splitmix64: generators with different streams are independent, and the
+ * same seed and stream always give the same samples, however the calls are
+ * split.
+ */
+class NoiseGenerator {
+public:
+  explicit NoiseGenerator(uint64_t seed = 0, uint64_t stream = 0) {
+    setSeed(seed, stream);
+  }
+
+  void setSeed(uint64_t seed, uint64_t stream = 0) {
+    uint64_t mix = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (size_t l = 0; l < kLanes; ++l) {
+      uint64_t a = splitMix64(mix), b = splitMix64(mix);
+      m_s0[l] = (uint32_t)a;
+      m_s1[l] = (uint32_t)(a >> 32);
+      m_s2[l] = (uint32_t)b;
+      m_s3[l] = (uint32_t)(b >> 32);
+      if ((m_s0[l] | m_s1[l] | m_s2[l] | m_s3[l]) == 0) {
+        m_s0[l] = 1;
+      }
+    }
+    m_position = kLanes;
+    m_hasSpareGaussian = false;
+    for (size_t i = 0; i < 7; ++i) {
+      m_pink[i] = 0.F;
+    }
+  }
+
+  // in [min, max)
+  template <class T>
+  void uniform(T* out, size_t n, T min, T max) {
+    const float scale = (float)(max - min) * kToUnit;
+    size_t i = 0;
+    for (; i < n && m_position < kLanes; ++i) {
+      out[i] = min + (T)((m_batch[m_position++] >> 8) * scale);
+    }
+    // whole batches straight into the output
+    for (; i + kLanes <= n; i += kLanes) {
+      nextBatch();
+      for (size_t l = 0; l < kLanes; ++l) {
+        out[i + l] = min + (T)((m_batch[l] >> 8) * scale);
+      }
+    }
+    for (; i < n; ++i) {
+      out[i] = min + (T)((nextBits() >> 8) * scale);
+    }
+  }
+
+  // normal distribution, with the Box-Muller transform
+  template <class T>
+  void gaussian(T* out, size_t n, T mean, T deviation) {
+    size_t i = 0;
+    if (n > 0 && m_hasSpareGaussian) {
+      out[i++] = mean + deviation * (T)m_spareGaussian;
+      m_hasSpareGaussian = false;
+    }
+    for (; i < n; i += 2) {
+      // (0, 1] so that the log is finite
+      const float u1 = ((nextBits() >> 8) + 1) * kToUnit;
+      const float u2 = (nextBits() >> 8) * kToUnit;
+      const float radius = std::sqrt(-2.F * std::log(u1));
+      const float angle = 2.F * (float)M_PI * u2;
+      out[i] = mean + deviation * (T)(radius * std::cos(angle));
+      const float second = radius * std::sin(angle);
+      if (i + 1 < n) {
+        out[i + 1] = mean + deviation * (T)second;
+      } else {
+        m_spareGaussian = second;
+        m_hasSpareGaussian = true;
+      }
+    }
+  }
+
+  // -3 dB per octave, Paul Kellet's filter over uniform white noise. The
+  // level is about the one of uniform noise in [-amplitude, amplitude)
+  template <class T>
+  void pink(T* out, size_t n, T amplitude) {
+    float* b = m_pink;
+    const float gain = 0.11F * (float)amplitude;
+    for (size_t i = 0; i < n; ++i) {
+      const float white = (nextBits() >> 8) * (2.F * kToUnit) - 1.F;
+      b[0] = 0.99886F * b[0] + white * 0.0555179F;
+      b[1] = 0.99332F * b[1] + white * 0.0750759F;
+      b[2] = 0.96900F * b[2] + white * 0.1538520F;
+      b[3] = 0.86650F * b[3] + white * 0.3104856F;
+      b[4] = 0.55000F * b[4] + white * 0.5329522F;
+      b[5] = -0.7616F * b[5] - white * 0.0168980F;
+      out[i] = (T)((b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + white * 0.5362F) * gain);
+      b[6] = white * 0.115926F;
+    }
+  }
+
+private:
+  static const size_t kLanes = 8;
+  static constexpr float kToUnit = 1.F / 16777216.F;
+
+  static uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  uint32_t nextBits() {
+    if (m_position == kLanes) {
+      nextBatch();
+      m_position = 0;
+    }
+    return m_batch[m_position++];
+  }
+
+  // the batch is used up, m_position is left alone
+  void nextBatch() {
+    for (size_t l = 0; l < kLanes; ++l) {
+      m_batch[l] = m_s0[l] + m_s3[l];
+      const uint32_t t = m_s1[l] << 9;
+      m_s2[l] ^= m_s0[l];
+      m_s3[l] ^= m_s1[l];
+      m_s1[l] ^= m_s2[l];
+      m_s0[l] ^= m_s3[l];
+      m_s2[l] ^= t;
+      m_s3[l] = (m_s3[l] << 11) | (m_s3[l] >> 21);
+    }
+  }
+
+  uint32_t m_s0[kLanes], m_s1[kLanes], m_s2[kLanes], m_s3[kLanes];
+  uint32_t m_batch[kLanes];
+  size_t m_position;
+  float m_spareGaussian;
+  bool m_hasSpareGaussian;
+  float m_pink[7];
+};
+
+// a different seed every time it's called, the same sequence of seeds in every run
+inline uint64_t nextNoiseSeed() {
+  static std::atomic<uint64_t> counter(0);
+  return counter++;
+}
+
+}
+
+#endif // __NOISE_HPP__
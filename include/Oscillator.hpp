@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __OSCILLATOR_HPP__
+#define __OSCILLATOR_HPP__
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <cstddef>
+
+namespace asu {
+
+/**
+ * A bank of sine partials summed in one pass. Every partial runs as a
+ * complex number rotated once per sample, kLanes consecutive samples at a
+ * time so that the loop vectorizes; at the start of each block of
+ * kBlockSize samples the rotation is reseeded from a phase accumulator kept
+ * in double, so the float recurrence never drifts. sin() is only called a
+ * couple of times per block and partial.
+ * Phases are in radians, a partial starting at phase 0 is a sine.
+ */
+template <class FTYPE>
+class OscillatorBankC {
+public:
+  explicit OscillatorBankC(double samplingRate = 44100.) : m_samplingRate(samplingRate) {}
+
+  // returns the index of the new partial
+  size_t addPartial(double frequency, double amplitude = 1., double phase = 0.) {
+    Partial partial;
+    partial.increment = 2. * M_PI * frequency / m_samplingRate;
+    partial.amplitude = amplitude;
+    partial.phase = partial.startPhase = phase;
+    m_partials.push_back(partial);
+    return m_partials.size() - 1;
+  }
+
+  // the phase carries on, so sweeps can be made a block at a time
+  void setFrequency(size_t partial, double frequency) {
+    assert(partial < m_partials.size());
+    m_partials[partial].increment = 2. * M_PI * frequency / m_samplingRate;
+  }
+
+  void setAmplitude(size_t partial, double amplitude) {
+    assert(partial < m_partials.size());
+    m_partials[partial].amplitude = amplitude;
+  }
+
+  size_t getNumberOfPartials() const { return m_partials.size(); }
+  double getSamplingRate() const { return m_samplingRate; }
+
+  void clear() { m_partials.clear(); }
+
+  // back to the phases the partials were added with
+  void reset() {
+    for (auto& partial : m_partials) {
+      partial.phase = partial.startPhase;
+    }
+  }
+
+  // adds the next numSamples samples of the sum of the partials to out
+  void addTo(FTYPE* out, size_t numSamples) {
+    for (size_t start = 0; start < numSamples; start += kBlockSize) {
+      const size_t count = std::min((size_t)kBlockSize, numSamples - start);
+      for (auto& partial : m_partials) {
+        addBlock(partial, out + start, count);
+        partial.phase = std::fmod(partial.phase + partial.increment * count, 2. * M_PI);
+      }
+    }
+  }
+
+private:
+  static const size_t kLanes = 8;
+  static const size_t kBlockSize = 256;
+
+  struct Partial {
+    double increment;
+    double amplitude;
+    double phase;
+    double startPhase;
+  };
+
+  static void addBlock(const Partial& partial, FTYPE* out, size_t count) {
+    // the first kLanes samples exactly, then the whole group turns at once
+    FTYPE re[kLanes], im[kLanes];
+    const double stepRe = std::cos(partial.increment), stepIm = std::sin(partial.increment);
+    double valueRe = partial.amplitude * std::cos(partial.phase);
+    double valueIm = partial.amplitude * std::sin(partial.phase);
+    for (size_t l = 0; l < kLanes; ++l) {
+      re[l] = (FTYPE)valueRe;
+      im[l] = (FTYPE)valueIm;
+      const double nextRe = valueRe * stepRe - valueIm * stepIm;
+      valueIm = valueRe * stepIm + valueIm * stepRe;
+      valueRe = nextRe;
+    }
+    const FTYPE rotationRe = (FTYPE)std::cos(partial.increment * kLanes);
+    const FTYPE rotationIm = (FTYPE)std::sin(partial.increment * kLanes);
+    size_t i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+      for (size_t l = 0; l < kLanes; ++l) {
+        out[i + l] += im[l];
+      }
+      for (size_t l = 0; l < kLanes; ++l) {
+        const FTYPE nextRe = re[l] * rotationRe - im[l] * rotationIm;
+        im[l] = re[l] * rotationIm + im[l] * rotationRe;
+        re[l] = nextRe;
+      }
+    }
+    for (size_t l = 0; i + l < count; ++l) {
+      out[i + l] += im[l];
+    }
+  }
+
+  double m_samplingRate;
+  std::vector<Partial> m_partials;
+};
+
+typedef OscillatorBankC<float> OscillatorBank;
+
+}
+
+#endif // __OSCILLATOR_HPP__
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __RESAMPLER_HPP__
+#define __RESAMPLER_HPP__
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cmath>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+#include "VectorKernels.h"
+#include "AudioBufferView.hpp"
+
+namespace asu {
+
+typedef enum ResamplerQuality_ {
+  ASU_RESAMPLER_FAST,
+  ASU_RESAMPLER_NORMAL,
+  ASU_RESAMPLER_BEST
+} ResamplerQuality;
+
+/**
+ * Polyphase windowed-sinc sample rate converter. The rates are reduced to a
+ * ratio of integers L/M, and the filter is tabulated for the L fractional
+ * positions an output sample can fall on, so 44.1k <-> 48k (160/147) or
+ * integer factors run with exact coefficients and no interpolation. Ratios
+ * needing more than kMaxExactPhases phases interpolate between the phases of
+ * a finer table. The tables are built once per ratio and quality and shared
+ * by every resampler in the process.
+ * The input is queued per channel, each output frame is one dot product per
+ * channel against the same taps. Rates are rounded to the hertz.
+ */
+template <class FTYPE>
+class ResamplerC {
+public:
+  ResamplerC() :
+    m_upFactor(1),
+    m_downFactor(1),
+    m_halfLength(0),
+    m_numberOfChannels(0) {
+    reset();
+  }
+
+  // false if a rate isn't positive or there are no channels
+  bool init(double inputRate, double outputRate, size_t numberOfChannels,
+    ResamplerQuality quality = ASU_RESAMPLER_NORMAL) {
+    const uint64_t in = (uint64_t)std::llround(inputRate);
+    const uint64_t out = (uint64_t)std::llround(outputRate);
+    if (in == 0 || out == 0 || numberOfChannels == 0) {
+      return false;
+    }
+    const uint64_t divisor = gcd(in, out);
+    m_upFactor = out / divisor;
+    m_downFactor = in / divisor;
+    m_numberOfChannels = numberOfChannels;
+    m_table = getTable(m_upFactor, m_downFactor, quality);
+    m_halfLength = m_table->numberOfTaps / 2;
+    m_taps.resize(m_table->numberOfTaps);
+    m_queue.assign(numberOfChannels, std::vector<FTYPE>());
+    reset();
+    return true;
+  }
+
+  // forgets the queued input, the next frame is the start of a new signal
+  void reset() {
+    m_nextInput = 0;
+    m_phase = 0;
+    m_inputFrames = 0;
+    m_outputFrames = 0;
+    m_flushing = false;
+    // the filter reaches into the past, that starts silent
+    m_queueStart = -(int64_t)m_halfLength + 1;
+    for (auto& queue : m_queue) {
+      queue.assign(m_halfLength > 0 ? m_halfLength - 1 : 0, FTYPE(0));
+    }
+  }
+
+  size_t getNumberOfChannels() const { return m_numberOfChannels; }
+  double getRatio() const { return (double)m_upFactor / m_downFactor; }
+
+  // frames out of a signal of inputLength frames, once flushed
+  size_t getOutputLength(size_t inputLength) const {
+    return (size_t)(((uint64_t)inputLength * m_upFactor + m_downFactor - 1) / m_downFactor);
+  }
+
+  // queues the input and writes the frames that are ready, at most the length
+  // of output. Returns how many were written, the rest comes out of the next
+  // calls. The input is queued before anything is written, so output can be
+  // the same samples as input when the rate goes down
+  size_t process(const AudioBufferViewC<const FTYPE>& input, const AudioBufferViewC<FTYPE>& output) {
+    assert(!m_flushing && input.getNumberOfChannels() >= m_numberOfChannels);
+    dropConsumed();
+    for (size_t ch = 0; ch < m_numberOfChannels; ++ch) {
+      m_queue[ch].insert(m_queue[ch].end(), input[ch], input[ch] + input.getLength());
+    }
+    m_inputFrames += input.getLength();
+    return render(output);
+  }
+
+  // the input has ended: writes the frames still due, call until it returns 0
+  size_t flush(const AudioBufferViewC<FTYPE>& output) {
+    if (!m_flushing) {
+      dropConsumed();
+      // enough silence for the filter of the last frame
+      for (auto& queue : m_queue) {
+        queue.insert(queue.end(), m_halfLength, FTYPE(0));
+      }
+      m_flushing = true;
+    }
+    return render(output);
+  }
+
+private:
+  static const size_t kMaxExactPhases = 1024;
+  static const size_t kInterpolatedPhases = 512;
+
+  struct Table {
+    size_t numberOfPhases;
+    size_t numberOfTaps;
+    // phases between two rows are interpolated, otherwise there's a row per phase
+    bool interpolated;
+    // numberOfPhases + 1 rows of numberOfTaps, the last one is a whole sample later than the first
+    std::vector<FTYPE> taps;
+  };
+
+  static uint64_t gcd(uint64_t a, uint64_t b) {
+    while (b != 0) {
+      uint64_t r = a % b;
+      a = b;
+      b = r;
+    }
+    return a;
+  }
+
+  static double besselI0(double x) {
+    double sum = 1, term = 1;
+    for (int k = 1; k < 50; ++k) {
+      term *= (x / (2 * k)) * (x / (2 * k));
+      sum += term;
+      if (term < sum * 1e-16) {
+        break;
+      }
+    }
+    return sum;
+  }
+
+  static std::shared_ptr<const Table> getTable(uint64_t up, uint64_t down, ResamplerQuality quality) {
+    static std::mutex mutex;
+    static std::map<std::vector<uint64_t>, std::shared_ptr<const Table> > tables;
+    std::vector<uint64_t> key = { up, down, (uint64_t)quality };
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const Table>& table = tables[key];
+    if (!table) {
+      table = buildTable(up, down, quality);
+    }
+    return table;
+  }
+
+  static std::shared_ptr<const Table> buildTable(uint64_t up, uint64_t down, ResamplerQuality quality) {
+    // zero crossings on each side, passband as a fraction of the lower
+    // Nyquist frequency, and the Kaiser window beta
+    static const double kZeroCrossings[] = { 8, 24, 64 };
+    static const double kPassband[] = { .86, .93, .97 };
+    static const double kBeta[] = { 6, 9, 12 };
+    // when decimating the filter gets narrower, so it needs more taps
+    const double scale = std::min(1.0, (double)up / down) * kPassband[quality];
+    const size_t halfLength = (size_t)std::ceil(kZeroCrossings[quality] / scale);
+    std::shared_ptr<Table> table(new Table());
+    table->interpolated = up > kMaxExactPhases;
+    table->numberOfPhases = table->interpolated ? kInterpolatedPhases : (size_t)up;
+    table->numberOfTaps = 2 * halfLength;
+    table->taps.resize((table->numberOfPhases + 1) * table->numberOfTaps);
+    const double beta = kBeta[quality];
+    const double windowNorm = besselI0(beta);
+    for (size_t p = 0; p <= table->numberOfPhases; ++p) {
+      const double fraction = (double)p / table->numberOfPhases;
+      FTYPE* row = &table->taps[p * table->numberOfTaps];
+      double sum = 0;
+      std::vector<double> weights(table->numberOfTaps);
+      for (size_t j = 0; j < table->numberOfTaps; ++j) {
+        // distance of this input sample from the output frame
+        const double x = (double)j - (double)halfLength + 1 - fraction;
+        const double r = x / halfLength;
+        const double window = std::fabs(r) >= 1 ? 0 : besselI0(beta * std::sqrt(1 - r * r)) / windowNorm;
+        const double sinc = x == 0 ? 1 : std::sin(M_PI * scale * x) / (M_PI * scale * x);
+        weights[j] = scale * sinc * window;
+        sum += weights[j];
+      }
+      // every phase passes DC with unity gain
+      for (size_t j = 0; j < table->numberOfTaps; ++j) {
+        row[j] = (FTYPE)(weights[j] / sum);
+      }
+    }
+    return table;
+  }
+
+  // the queued samples before the filter of the next frame aren't needed anymore
+  void dropConsumed() {
+    const int64_t firstNeeded = m_nextInput - (int64_t)m_halfLength + 1;
+    const size_t drop = (size_t)std::max((int64_t)0, firstNeeded - m_queueStart);
+    if (drop == 0) {
+      return;
+    }
+    for (auto& queue : m_queue) {
+      queue.erase(queue.begin(), queue.begin() + std::min(drop, queue.size()));
+    }
+    m_queueStart += drop;
+  }
+
+  const FTYPE* tapsForPhase() {
+    const Table& table = *m_table;
+    if (!table.interpolated) {
+      return &table.taps[m_phase * table.numberOfTaps];
+    }
+    const double position = (double)m_phase * table.numberOfPhases / m_upFactor;
+    const size_t row = (size_t)position;
+    const FTYPE t = (FTYPE)(position - row);
+    const FTYPE* a = &table.taps[row * table.numberOfTaps];
+    const FTYPE* b = a + table.numberOfTaps;
+    for (size_t j = 0; j < table.numberOfTaps; ++j) {
+      m_taps[j] = a[j] + (b[j] - a[j]) * t;
+    }
+    return &m_taps[0];
+  }
+
+  size_t render(const AudioBufferViewC<FTYPE>& output) {
+    assert(output.getNumberOfChannels() >= m_numberOfChannels);
+    const size_t queued = m_queue.empty() ? 0 : m_queue[0].size();
+    const size_t due = getOutputLength(m_inputFrames);
+    size_t written = 0;
+    while (written < output.getLength()) {
+      if (m_flushing && m_outputFrames >= due) {
+        break;
+      }
+      const int64_t first = m_nextInput - (int64_t)m_halfLength + 1;
+      if (first - m_queueStart + (int64_t)m_table->numberOfTaps > (int64_t)queued) {
+        break;
+      }
+      const FTYPE* taps = tapsForPhase();
+      const size_t offset = (size_t)(first - m_queueStart);
+      for (size_t ch = 0; ch < m_numberOfChannels; ++ch) {
+        output[ch][written] = kernels::dot(&m_queue[ch][offset], taps, m_table->numberOfTaps);
+      }
+      m_phase += m_downFactor;
+      m_nextInput += m_phase / m_upFactor;
+      m_phase %= m_upFactor;
+      ++m_outputFrames;
+      ++written;
+    }
+    return written;
+  }
+
+  uint64_t m_upFactor;
+  uint64_t m_downFactor;
+  size_t m_halfLength;
+  size_t m_numberOfChannels;
+  std::shared_ptr<const Table> m_table;
+  std::vector<FTYPE> m_taps;
+  // the input samples from m_queueStart on, for each channel
+  std::vector<std::vector<FTYPE> > m_queue;
+  int64_t m_queueStart;
+  // the next output frame falls m_phase / m_upFactor after input m_nextInput
+  int64_t m_nextInput;
+  uint64_t m_phase;
+  uint64_t m_inputFrames;
+  uint64_t m_outputFrames;
+  bool m_flushing;
+};
+
+typedef ResamplerC<float> Resampler;
+
+}
+
+#endif // __RESAMPLER_HPP__
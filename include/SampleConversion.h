@@ -0,0 +1,735 @@
+//
+//  SampleConversion.h
+//  asutilities
+//
+//  Created by Alessandro Saccoia on 10/17/26.
+//
+//  Conversions between interleaved integer or float samples, as decoders and
+//  files want them, and the planar float channels of AudioBufferC. Integers
+//  are read as value / 2^(bits - 1) and written clipped to [-1, 1] and scaled
+//  by 2^(bits - 1) - 1, rounding to nearest. Float, 16, 24 and 32 bit
+//  conversions have SSE2 versions for up to 256 channels, picked at runtime
+//  like VectorKernels.h, that give the same results as the scalar ones.
+//  Going down to 16 or 24 bits can add triangular dither, which is scalar.
+//
+
+#ifndef SampleConversion_h
+#define SampleConversion_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "VectorKernels.h"
+
+namespace asu {
+namespace conversion {
+
+// triangular noise of one least significant bit peak, so that requantization
+// error is decorrelated from the signal
+class TpdfDither {
+public:
+  explicit TpdfDither(uint32_t seed = 22222) : m_state(seed ? seed : 1) {}
+
+  // in (-1, 1), to be added to the sample already scaled to the integer range
+  float next() {
+    return uniform() - uniform();
+  }
+
+private:
+  float uniform() {
+    // xorshift32, the top 24 bits make a float in [0, 1)
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return (m_state >> 8) * (1.F / 16777216.F);
+  }
+  uint32_t m_state;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Scalar versions
+////////////////////////////////////////////////////////////////////////////////
+
+namespace scalar {
+
+inline float clip(float value) {
+  return std::min(1.F, std::max(-1.F, value));
+}
+
+// interleaved in to numFrames samples at the start of each out channel
+template <class T>
+inline void deinterleave(const T* in, T* const* out, unsigned int channels, size_t numFrames) {
+  for (unsigned int ch = 0; ch < channels; ++ch) {
+    const T* pin = in + ch;
+    T* o = out[ch];
+    for (size_t i = 0; i < numFrames; ++i) {
+      o[i] = pin[i * channels];
+    }
+  }
+}
+
+inline void deinterleave(const int16_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  for (unsigned int ch = 0; ch < channels; ++ch) {
+    const int16_t* pin = in + ch;
+    float* o = out[ch];
+    for (size_t i = 0; i < numFrames; ++i) {
+      o[i] = pin[i * channels] * (1.F / 32768.F);
+    }
+  }
+}
+
+inline void deinterleave(const int32_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  for (unsigned int ch = 0; ch < channels; ++ch) {
+    const int32_t* pin = in + ch;
+    float* o = out[ch];
+    for (size_t i = 0; i < numFrames; ++i) {
+      o[i] = pin[i * channels] * (1.F / 2147483648.F);
+    }
+  }
+}
+
+// packed little endian 24 bit samples
+inline void deinterleaveInt24(const unsigned char* in, float* const* out, unsigned int channels, size_t numFrames) {
+  const size_t stride = 3 * channels;
+  for (unsigned int ch = 0; ch < channels; ++ch) {
+    const unsigned char* pin = in + ch * 3;
+    float* o = out[ch];
+    for (size_t i = 0; i < numFrames; ++i, pin += stride) {
+      int32_t v = (int32_t)(((uint32_t)pin[2] << 24) | (pin[1] << 16) | (pin[0] << 8));
+      o[i] = (v >> 8) * (1.F / 8388608.F);
+    }
+  }
+}
+
+// numFrames samples at the start of each in channel to interleaved out
+template <class T>
+inline void interleave(const T* const* in, T* out, unsigned int channels, size_t numFrames) {
+  for (unsigned int ch = 0; ch < channels; ++ch) {
+    const T* pin = in[ch];
+    T* o = out + ch;
+    for (size_t i = 0; i < numFrames; ++i) {
+      o[i * channels] = pin[i];
+    }
+  }
+}
+
+inline void interleave(const float* const* in, int16_t* out, unsigned int channels, size_t numFrames, TpdfDither* dither = nullptr) {
+  if (dither != nullptr) {
+    // frame by frame, so that the noise sequence doesn't depend on the layout
+    for (size_t i = 0; i < numFrames; ++i) {
+      for (unsigned int ch = 0; ch < channels; ++ch) {
+        float v = clip(in[ch][i]) * 32767.F + dither->next();
+        out[i * channels + ch] = (int16_t)std::min(32767L, std::max(-32768L, std::lrint(v)));
+      }
+    }
+    return;
+  }
+  for (unsigned int ch = 0; ch < channels; ++ch) {
+    const float* pin = in[ch];
+    int16_t* o = out + ch;
+    for (size_t i = 0; i < numFrames; ++i) {
+      o[i * channels] = (int16_t)std::lrint(clip(pin[i]) * 32767.F);
+    }
+  }
+}
+
+inline void interleave(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames) {
+  for (unsigned int ch = 0; ch < channels; ++ch) {
+    const float* pin = in[ch];
+    int32_t* o = out + ch;
+    for (size_t i = 0; i < numFrames; ++i) {
+      // in double, 2^31 - 1 is not representable as a float
+      o[i * channels] = (int32_t)std::lrint(clip(pin[i]) * 2147483647.0);
+    }
+  }
+}
+
+inline int32_t toInt24(float value, TpdfDither* dither) {
+  float v = clip(value) * 8388607.F;
+  if (dither != nullptr) {
+    v += dither->next();
+  }
+  return (int32_t)std::min(8388607L, std::max(-8388608L, std::lrint(v)));
+}
+
+inline void interleaveInt24(const float* const* in, unsigned char* out, unsigned int channels, size_t numFrames, TpdfDither* dither = nullptr) {
+  for (size_t i = 0; i < numFrames; ++i) {
+    for (unsigned int ch = 0; ch < channels; ++ch) {
+      int32_t s = toInt24(in[ch][i], dither);
+      unsigned char* o = out + (i * channels + ch) * 3;
+      o[0] = (unsigned char)(s & 0xFF);
+      o[1] = (unsigned char)((s >> 8) & 0xFF);
+      o[2] = (unsigned char)((s >> 16) & 0xFF);
+    }
+  }
+}
+
+// 24 bit samples in the top of 32 bit words, as libsndfile wants them
+inline void interleaveInt24(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames, TpdfDither* dither = nullptr) {
+  for (size_t i = 0; i < numFrames; ++i) {
+    for (unsigned int ch = 0; ch < channels; ++ch) {
+      out[i * channels + ch] = (int32_t)((uint32_t)toInt24(in[ch][i], dither) << 8);
+    }
+  }
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ASU_KERNELS_SSE2
+namespace sse2 {
+
+// four frames at a time, channels are taken in groups of four with a 4x4
+// transpose, the ones left over are copied one by one
+ASU_TARGET_SSE2 inline void deinterleaveFloatWide(const float* in, float* const* out, unsigned int channels, size_t numFrames) {
+  const unsigned int grouped = channels & ~3U;
+  size_t i = 0;
+  for (; i + 4 <= numFrames; i += 4) {
+    const float* frames = in + i * channels;
+    for (unsigned int ch = 0; ch < grouped; ch += 4) {
+      __m128 r0 = _mm_loadu_ps(frames + ch);
+      __m128 r1 = _mm_loadu_ps(frames + channels + ch);
+      __m128 r2 = _mm_loadu_ps(frames + 2 * channels + ch);
+      __m128 r3 = _mm_loadu_ps(frames + 3 * channels + ch);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(out[ch] + i, r0);
+      _mm_storeu_ps(out[ch + 1] + i, r1);
+      _mm_storeu_ps(out[ch + 2] + i, r2);
+      _mm_storeu_ps(out[ch + 3] + i, r3);
+    }
+    for (unsigned int ch = grouped; ch < channels; ++ch) {
+      for (size_t k = 0; k < 4; ++k) {
+        out[ch][i + k] = frames[k * channels + ch];
+      }
+    }
+  }
+  for (; i < numFrames; ++i) {
+    for (unsigned int ch = 0; ch < channels; ++ch) {
+      out[ch][i] = in[i * channels + ch];
+    }
+  }
+}
+
+ASU_TARGET_SSE2 inline void interleaveFloatWide(const float* const* in, float* out, unsigned int channels, size_t numFrames) {
+  const unsigned int grouped = channels & ~3U;
+  size_t i = 0;
+  for (; i + 4 <= numFrames; i += 4) {
+    float* frames = out + i * channels;
+    for (unsigned int ch = 0; ch < grouped; ch += 4) {
+      __m128 r0 = _mm_loadu_ps(in[ch] + i);
+      __m128 r1 = _mm_loadu_ps(in[ch + 1] + i);
+      __m128 r2 = _mm_loadu_ps(in[ch + 2] + i);
+      __m128 r3 = _mm_loadu_ps(in[ch + 3] + i);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(frames + ch, r0);
+      _mm_storeu_ps(frames + channels + ch, r1);
+      _mm_storeu_ps(frames + 2 * channels + ch, r2);
+      _mm_storeu_ps(frames + 3 * channels + ch, r3);
+    }
+    for (unsigned int ch = grouped; ch < channels; ++ch) {
+      for (size_t k = 0; k < 4; ++k) {
+        frames[k * channels + ch] = in[ch][i + k];
+      }
+    }
+  }
+  for (; i < numFrames; ++i) {
+    for (unsigned int ch = 0; ch < channels; ++ch) {
+      out[i * channels + ch] = in[ch][i];
+    }
+  }
+}
+
+ASU_TARGET_SSE2 inline void deinterleaveFloat(const float* in, float* const* out, unsigned int channels, size_t numFrames) {
+  if (channels == 1) {
+    std::copy(in, in + numFrames, out[0]);
+    return;
+  }
+  if (channels != 2) {
+    if (channels >= 4) {
+      deinterleaveFloatWide(in, out, channels, numFrames);
+    } else {
+      scalar::deinterleave(in, out, channels, numFrames);
+    }
+    return;
+  }
+  float* left = out[0];
+  float* right = out[1];
+  size_t i = 0;
+  for (; i + 4 <= numFrames; i += 4) {
+    __m128 a = _mm_loadu_ps(in + 2 * i);
+    __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+    _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  float* tail[2] = { left + i, right + i };
+  scalar::deinterleave(in + 2 * i, tail, 2, numFrames - i);
+}
+
+ASU_TARGET_SSE2 inline void interleaveFloat(const float* const* in, float* out, unsigned int channels, size_t numFrames) {
+  if (channels == 1) {
+    std::copy(in[0], in[0] + numFrames, out);
+    return;
+  }
+  if (channels != 2) {
+    if (channels >= 4) {
+      interleaveFloatWide(in, out, channels, numFrames);
+    } else {
+      scalar::interleave(in, out, channels, numFrames);
+    }
+    return;
+  }
+  const float* left = in[0];
+  const float* right = in[1];
+  size_t i = 0;
+  for (; i + 4 <= numFrames; i += 4) {
+    __m128 l = _mm_loadu_ps(left + i);
+    __m128 r = _mm_loadu_ps(right + i);
+    _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+  }
+  const float* tail[2] = { left + i, right + i };
+  scalar::interleave(tail, out + 2 * i, 2, numFrames - i);
+}
+
+// clipped and scaled to the 16 bit range, the conversion rounds to nearest
+ASU_TARGET_SSE2 inline __m128i toInt32(__m128 v) {
+  const __m128 lo = _mm_set1_ps(-1.F);
+  const __m128 hi = _mm_set1_ps(1.F);
+  const __m128 k = _mm_set1_ps(32767.F);
+  return _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, lo), hi), k));
+}
+
+// Contiguous conversions, a row of samples with no regard for channels. With
+// the float (de)interleaving above they make the conversions for any number
+// of channels, and round exactly like the scalar ones
+
+ASU_TARGET_SSE2 inline void int16ToFloat(const int16_t* in, float* out, size_t n) {
+  const __m128 k = _mm_set1_ps(1.F / 32768.F);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), k));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), k));
+  }
+  for (; i < n; ++i) {
+    out[i] = in[i] * (1.F / 32768.F);
+  }
+}
+
+ASU_TARGET_SSE2 inline void int32ToFloat(const int32_t* in, float* out, size_t n) {
+  const __m128 k = _mm_set1_ps(1.F / 2147483648.F);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in + i))), k));
+  }
+  for (; i < n; ++i) {
+    out[i] = in[i] * (1.F / 2147483648.F);
+  }
+}
+
+// packed little endian 24 bit samples
+ASU_TARGET_SSE2 inline void int24ToFloat(const unsigned char* in, float* out, size_t n) {
+  const __m128 k = _mm_set1_ps(1.F / 8388608.F);
+  size_t i = 0;
+  // four samples are 12 bytes, the load reads 16 and must stay in the input
+  for (; i + 6 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(in + 3 * i));
+    // each sample to the top of the first lane of its own register
+    __m128i s0 = _mm_slli_epi32(v, 8);
+    __m128i s1 = _mm_slli_epi32(_mm_srli_si128(v, 3), 8);
+    __m128i s2 = _mm_slli_epi32(_mm_srli_si128(v, 6), 8);
+    __m128i s3 = _mm_slli_epi32(_mm_srli_si128(v, 9), 8);
+    __m128i samples = _mm_unpacklo_epi64(_mm_unpacklo_epi32(s0, s1), _mm_unpacklo_epi32(s2, s3));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(samples, 8)), k));
+  }
+  for (; i < n; ++i) {
+    const unsigned char* pin = in + 3 * i;
+    int32_t v = (int32_t)(((uint32_t)pin[2] << 24) | (pin[1] << 16) | (pin[0] << 8));
+    out[i] = (v >> 8) * (1.F / 8388608.F);
+  }
+}
+
+ASU_TARGET_SSE2 inline void floatToInt16(const float* in, int16_t* out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(toInt32(_mm_loadu_ps(in + i)), toInt32(_mm_loadu_ps(in + i + 4))));
+  }
+  for (; i < n; ++i) {
+    out[i] = (int16_t)std::lrint(scalar::clip(in[i]) * 32767.F);
+  }
+}
+
+// clipped in float and scaled in double, 2^31 - 1 is not representable as a float
+ASU_TARGET_SSE2 inline void floatToInt32(const float* in, int32_t* out, size_t n) {
+  const __m128 lo = _mm_set1_ps(-1.F);
+  const __m128 hi = _mm_set1_ps(1.F);
+  const __m128d k = _mm_set1_pd(2147483647.0);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+    __m128i a = _mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtps_pd(v), k));
+    __m128i b = _mm_cvtpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), k));
+    _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi64(a, b));
+  }
+  for (; i < n; ++i) {
+    out[i] = (int32_t)std::lrint(scalar::clip(in[i]) * 2147483647.0);
+  }
+}
+
+ASU_TARGET_SSE2 inline __m128i toInt24(__m128 v) {
+  const __m128 lo = _mm_set1_ps(-1.F);
+  const __m128 hi = _mm_set1_ps(1.F);
+  const __m128 k = _mm_set1_ps(8388607.F);
+  return _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, lo), hi), k));
+}
+
+// 24 bit samples in the top of 32 bit words
+ASU_TARGET_SSE2 inline void floatToInt24Words(const float* in, int32_t* out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_si128((__m128i*)(out + i), _mm_slli_epi32(toInt24(_mm_loadu_ps(in + i)), 8));
+  }
+  for (; i < n; ++i) {
+    out[i] = (int32_t)((uint32_t)scalar::toInt24(in[i], nullptr) << 8);
+  }
+}
+
+// packed little endian, SSE2 can't shuffle bytes so they are stored one by one
+ASU_TARGET_SSE2 inline void floatToInt24(const float* in, unsigned char* out, size_t n) {
+  size_t i = 0;
+  int32_t words[4];
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_si128((__m128i*)words, toInt24(_mm_loadu_ps(in + i)));
+    for (size_t k = 0; k < 4; ++k) {
+      unsigned char* o = out + 3 * (i + k);
+      o[0] = (unsigned char)(words[k] & 0xFF);
+      o[1] = (unsigned char)((words[k] >> 8) & 0xFF);
+      o[2] = (unsigned char)((words[k] >> 16) & 0xFF);
+    }
+  }
+  for (; i < n; ++i) {
+    int32_t s = scalar::toInt24(in[i], nullptr);
+    unsigned char* o = out + 3 * i;
+    o[0] = (unsigned char)(s & 0xFF);
+    o[1] = (unsigned char)((s >> 8) & 0xFF);
+    o[2] = (unsigned char)((s >> 16) & 0xFF);
+  }
+}
+
+// floats per block of the two pass conversions, on the stack. Layouts with
+// more channels than kMaxBlockChannels are converted by the scalar code
+const size_t kConversionBlock = 1024;
+const unsigned int kMaxBlockChannels = 256;
+
+// a block of frames is converted to float in a row and then deinterleaved.
+// T is the unit of the input, kWidth of them make a sample
+template <class T, unsigned int kWidth, void (*toFloat)(const T*, float*, size_t)>
+ASU_TARGET_SSE2 inline void deinterleaveBlocks(const T* in, float* const* out, unsigned int channels, size_t numFrames) {
+  float block[kConversionBlock];
+  const size_t framesPerBlock = kConversionBlock / channels;
+  float* channelPointers[kMaxBlockChannels];
+  for (size_t start = 0; start < numFrames; start += framesPerBlock) {
+    const size_t count = std::min(framesPerBlock, numFrames - start);
+    toFloat(in + start * channels * kWidth, block, count * channels);
+    for (unsigned int ch = 0; ch < channels; ++ch) {
+      channelPointers[ch] = out[ch] + start;
+    }
+    deinterleaveFloat(block, channelPointers, channels, count);
+  }
+}
+
+template <class T, unsigned int kWidth, void (*fromFloat)(const float*, T*, size_t)>
+ASU_TARGET_SSE2 inline void interleaveBlocks(const float* const* in, T* out, unsigned int channels, size_t numFrames) {
+  float block[kConversionBlock];
+  const size_t framesPerBlock = kConversionBlock / channels;
+  const float* channelPointers[kMaxBlockChannels];
+  for (size_t start = 0; start < numFrames; start += framesPerBlock) {
+    const size_t count = std::min(framesPerBlock, numFrames - start);
+    for (unsigned int ch = 0; ch < channels; ++ch) {
+      channelPointers[ch] = in[ch] + start;
+    }
+    interleaveFloat(channelPointers, block, channels, count);
+    fromFloat(block, out + start * channels * kWidth, count * channels);
+  }
+}
+
+ASU_TARGET_SSE2 inline void deinterleaveInt16(const int16_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  if (channels > 2) {
+    if (channels > kMaxBlockChannels) {
+      scalar::deinterleave(in, out, channels, numFrames);
+    } else {
+      deinterleaveBlocks<int16_t, 1, int16ToFloat>(in, out, channels, numFrames);
+    }
+    return;
+  }
+  const __m128 k = _mm_set1_ps(1.F / 32768.F);
+  size_t i = 0;
+  if (channels == 1) {
+    float* mono = out[0];
+    for (; i + 8 <= numFrames; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      _mm_storeu_ps(mono + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+      _mm_storeu_ps(mono + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    float* tail[1] = { mono + i };
+    scalar::deinterleave(in + i, tail, 1, numFrames - i);
+    return;
+  }
+  float* left = out[0];
+  float* right = out[1];
+  for (; i + 4 <= numFrames; i += 4) {
+    // every 32 bit lane holds a frame, left in the low half
+    __m128i v = _mm_loadu_si128((const __m128i*)(in + 2 * i));
+    __m128i l = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    __m128i r = _mm_srai_epi32(v, 16);
+    _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(l), k));
+    _mm_storeu_ps(right + i, _mm_mul_ps(_mm_cvtepi32_ps(r), k));
+  }
+  float* tail[2] = { left + i, right + i };
+  scalar::deinterleave(in + 2 * i, tail, 2, numFrames - i);
+}
+
+ASU_TARGET_SSE2 inline void interleaveInt16(const float* const* in, int16_t* out, unsigned int channels, size_t numFrames) {
+  if (channels > 2) {
+    if (channels > kMaxBlockChannels) {
+      scalar::interleave(in, out, channels, numFrames);
+    } else {
+      interleaveBlocks<int16_t, 1, floatToInt16>(in, out, channels, numFrames);
+    }
+    return;
+  }
+  size_t i = 0;
+  if (channels == 1) {
+    const float* mono = in[0];
+    for (; i + 8 <= numFrames; i += 8) {
+      __m128i a = toInt32(_mm_loadu_ps(mono + i));
+      __m128i b = toInt32(_mm_loadu_ps(mono + i + 4));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a, b));
+    }
+    const float* tail[1] = { mono + i };
+    scalar::interleave(tail, out + i, 1, numFrames - i);
+    return;
+  }
+  const float* left = in[0];
+  const float* right = in[1];
+  for (; i + 4 <= numFrames; i += 4) {
+    // l0 l1 l2 l3 r0 r1 r2 r3, then the two halves are interleaved
+    __m128i packed = _mm_packs_epi32(toInt32(_mm_loadu_ps(left + i)), toInt32(_mm_loadu_ps(right + i)));
+    _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8)));
+  }
+  const float* tail[2] = { left + i, right + i };
+  scalar::interleave(tail, out + 2 * i, 2, numFrames - i);
+}
+
+ASU_TARGET_SSE2 inline void deinterleaveInt32(const int32_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  if (channels > kMaxBlockChannels) {
+    scalar::deinterleave(in, out, channels, numFrames);
+    return;
+  }
+  deinterleaveBlocks<int32_t, 1, int32ToFloat>(in, out, channels, numFrames);
+}
+
+ASU_TARGET_SSE2 inline void deinterleaveInt24(const unsigned char* in, float* const* out, unsigned int channels, size_t numFrames) {
+  if (channels > kMaxBlockChannels) {
+    scalar::deinterleaveInt24(in, out, channels, numFrames);
+    return;
+  }
+  deinterleaveBlocks<unsigned char, 3, int24ToFloat>(in, out, channels, numFrames);
+}
+
+ASU_TARGET_SSE2 inline void interleaveInt32(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames) {
+  if (channels > kMaxBlockChannels) {
+    scalar::interleave(in, out, channels, numFrames);
+    return;
+  }
+  interleaveBlocks<int32_t, 1, floatToInt32>(in, out, channels, numFrames);
+}
+
+ASU_TARGET_SSE2 inline void interleaveInt24(const float* const* in, unsigned char* out, unsigned int channels, size_t numFrames) {
+  if (channels > kMaxBlockChannels) {
+    scalar::interleaveInt24(in, out, channels, numFrames);
+    return;
+  }
+  interleaveBlocks<unsigned char, 3, floatToInt24>(in, out, channels, numFrames);
+}
+
+ASU_TARGET_SSE2 inline void interleaveInt24Words(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames) {
+  if (channels > kMaxBlockChannels) {
+    scalar::interleaveInt24(in, out, channels, numFrames);
+    return;
+  }
+  interleaveBlocks<int32_t, 1, floatToInt24Words>(in, out, channels, numFrames);
+}
+
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Runtime dispatch
+////////////////////////////////////////////////////////////////////////////////
+
+struct ConversionTable {
+  void (*deinterleaveFloat)(const float*, float* const*, unsigned int, size_t);
+  void (*deinterleaveInt16)(const int16_t*, float* const*, unsigned int, size_t);
+  void (*deinterleaveInt24)(const unsigned char*, float* const*, unsigned int, size_t);
+  void (*deinterleaveInt32)(const int32_t*, float* const*, unsigned int, size_t);
+  void (*interleaveFloat)(const float* const*, float*, unsigned int, size_t);
+  void (*interleaveInt16)(const float* const*, int16_t*, unsigned int, size_t);
+  void (*interleaveInt24)(const float* const*, unsigned char*, unsigned int, size_t);
+  void (*interleaveInt24Words)(const float* const*, int32_t*, unsigned int, size_t);
+  void (*interleaveInt32)(const float* const*, int32_t*, unsigned int, size_t);
+  const char* name;
+};
+
+namespace detail {
+
+inline void scalarDeinterleaveFloat(const float* in, float* const* out, unsigned int channels, size_t numFrames) {
+  scalar::deinterleave(in, out, channels, numFrames);
+}
+
+inline void scalarDeinterleaveInt16(const int16_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  scalar::deinterleave(in, out, channels, numFrames);
+}
+
+inline void scalarDeinterleaveInt24(const unsigned char* in, float* const* out, unsigned int channels, size_t numFrames) {
+  scalar::deinterleaveInt24(in, out, channels, numFrames);
+}
+
+inline void scalarDeinterleaveInt32(const int32_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  scalar::deinterleave(in, out, channels, numFrames);
+}
+
+inline void scalarInterleaveFloat(const float* const* in, float* out, unsigned int channels, size_t numFrames) {
+  scalar::interleave(in, out, channels, numFrames);
+}
+
+inline void scalarInterleaveInt16(const float* const* in, int16_t* out, unsigned int channels, size_t numFrames) {
+  scalar::interleave(in, out, channels, numFrames);
+}
+
+inline void scalarInterleaveInt24(const float* const* in, unsigned char* out, unsigned int channels, size_t numFrames) {
+  scalar::interleaveInt24(in, out, channels, numFrames);
+}
+
+inline void scalarInterleaveInt24Words(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames) {
+  scalar::interleaveInt24(in, out, channels, numFrames);
+}
+
+inline void scalarInterleaveInt32(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames) {
+  scalar::interleave(in, out, channels, numFrames);
+}
+
+inline ConversionTable selectConversions() {
+  ConversionTable table = {
+    &scalarDeinterleaveFloat,
+    &scalarDeinterleaveInt16,
+    &scalarDeinterleaveInt24,
+    &scalarDeinterleaveInt32,
+    &scalarInterleaveFloat,
+    &scalarInterleaveInt16,
+    &scalarInterleaveInt24,
+    &scalarInterleaveInt24Words,
+    &scalarInterleaveInt32,
+    "scalar"
+  };
+  #ifdef ASU_KERNELS_SSE2
+  if (kernels::hasSse2()) {
+    ConversionTable sse = {
+      &sse2::deinterleaveFloat,
+      &sse2::deinterleaveInt16,
+      &sse2::deinterleaveInt24,
+      &sse2::deinterleaveInt32,
+      &sse2::interleaveFloat,
+      &sse2::interleaveInt16,
+      &sse2::interleaveInt24,
+      &sse2::interleaveInt24Words,
+      &sse2::interleaveInt32,
+      "sse2"
+    };
+    table = sse;
+  }
+  #endif
+  return table;
+}
+
+}
+
+// the conversions for this CPU, selected on the first call
+inline const ConversionTable& table() {
+  static const ConversionTable conversions = detail::selectConversions();
+  return conversions;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Entry points
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+inline void deinterleave(const T* in, T* const* out, unsigned int channels, size_t numFrames) {
+  scalar::deinterleave(in, out, channels, numFrames);
+}
+
+inline void deinterleave(const float* in, float* const* out, unsigned int channels, size_t numFrames) {
+  table().deinterleaveFloat(in, out, channels, numFrames);
+}
+
+inline void deinterleave(const int16_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  table().deinterleaveInt16(in, out, channels, numFrames);
+}
+
+inline void deinterleave(const int32_t* in, float* const* out, unsigned int channels, size_t numFrames) {
+  table().deinterleaveInt32(in, out, channels, numFrames);
+}
+
+inline void deinterleaveInt24(const unsigned char* in, float* const* out, unsigned int channels, size_t numFrames) {
+  table().deinterleaveInt24(in, out, channels, numFrames);
+}
+
+template <class T>
+inline void interleave(const T* const* in, T* out, unsigned int channels, size_t numFrames) {
+  scalar::interleave(in, out, channels, numFrames);
+}
+
+inline void interleave(const float* const* in, float* out, unsigned int channels, size_t numFrames) {
+  table().interleaveFloat(in, out, channels, numFrames);
+}
+
+// dithering is scalar, the noise has to be generated sample by sample anyway
+inline void interleave(const float* const* in, int16_t* out, unsigned int channels, size_t numFrames, TpdfDither* dither = nullptr) {
+  if (dither != nullptr) {
+    scalar::interleave(in, out, channels, numFrames, dither);
+  } else {
+    table().interleaveInt16(in, out, channels, numFrames);
+  }
+}
+
+inline void interleave(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames) {
+  table().interleaveInt32(in, out, channels, numFrames);
+}
+
+inline void interleaveInt24(const float* const* in, unsigned char* out, unsigned int channels, size_t numFrames, TpdfDither* dither = nullptr) {
+  if (dither != nullptr) {
+    scalar::interleaveInt24(in, out, channels, numFrames, dither);
+  } else {
+    table().interleaveInt24(in, out, channels, numFrames);
+  }
+}
+
+inline void interleaveInt24(const float* const* in, int32_t* out, unsigned int channels, size_t numFrames, TpdfDither* dither = nullptr) {
+  if (dither != nullptr) {
+    scalar::interleaveInt24(in, out, channels, numFrames, dither);
+  } else {
+    table().interleaveInt24Words(in, out, channels, numFrames);
+  }
+}
+
+}
+}
+
+#endif /* SampleConversion_h */
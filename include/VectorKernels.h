@@ -0,0 +1,719 @@
+//
+//  VectorKernels.h
+//  asutilities
+//
+//  Created by Alessandro Saccoia on 10/17/26.
+//
+//  Elementwise and reduction kernels used by AudioBufferC. The float versions
+//  are written with SSE2 and AVX2 intrinsics, the best one for the CPU is
+//  picked once at runtime; everything else uses the scalar templates.
+//  Elementwise kernels give the same results whatever the instruction set,
+//  reductions may differ in the last bits because of the summation order.
+//  Define ASU_DISABLE_SIMD to only compile the scalar versions.
+//
+
+#ifndef VectorKernels_h
+#define VectorKernels_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#if !defined(ASU_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+  #define ASU_KERNELS_SSE2 1
+  #include <emmintrin.h>
+  #if defined(__GNUC__)
+    // gcc and clang can compile AVX2 functions without -mavx2 for the whole file
+    #define ASU_KERNELS_AVX2 1
+    #include <immintrin.h>
+    #define ASU_TARGET_SSE2 __attribute__((target("sse2")))
+    #define ASU_TARGET_AVX2 __attribute__((target("avx2")))
+  #else
+    #define ASU_TARGET_SSE2
+  #endif
+#endif
+
+namespace asu {
+namespace kernels {
+
+// What a single pass over a run of samples finds out. The peak is the largest
+// absolute value, peakIndex the first sample that reaches it; clipped counts
+// the samples whose absolute value is at least the clip level
+template <class T>
+struct StatisticsC {
+  StatisticsC() :
+    length(0), min(0), max(0), peak(0), peakIndex(0), sum(0), sumOfSquares(0), clipped(0) {}
+
+  double mean() const { return length ? sum / length : 0.; }
+  double rms() const { return length ? std::sqrt(sumOfSquares / length) : 0.; }
+
+  // next is the run that comes right after this one
+  void append(const StatisticsC& next) {
+    if (next.length == 0) {
+      return;
+    }
+    if (length == 0) {
+      *this = next;
+      return;
+    }
+    min = std::min(min, next.min);
+    max = std::max(max, next.max);
+    if (next.peak > peak) {
+      peak = next.peak;
+      peakIndex = length + next.peakIndex;
+    }
+    sum += next.sum;
+    sumOfSquares += next.sumOfSquares;
+    clipped += next.clipped;
+    length += next.length;
+  }
+
+  size_t length;
+  T min;
+  T max;
+  T peak;
+  size_t peakIndex;
+  double sum;
+  double sumOfSquares;
+  size_t clipped;
+};
+
+typedef StatisticsC<float> Statistics;
+
+////////////////////////////////////////////////////////////////////////////////
+// Scalar versions, for any sample type
+////////////////////////////////////////////////////////////////////////////////
+
+namespace scalar {
+
+// dst *= gain
+template <class T>
+inline void scale(T* dst, size_t n, T gain) {
+  for (size_t i = 0; i < n; ++i) dst[i] *= gain;
+}
+
+// dst += value
+template <class T>
+inline void offset(T* dst, size_t n, T value) {
+  for (size_t i = 0; i < n; ++i) dst[i] += value;
+}
+
+// dst += src
+template <class T>
+inline void add(T* dst, const T* src, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] += src[i];
+}
+
+// dst = a + b
+template <class T>
+inline void add(T* dst, const T* a, const T* b, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] = a[i] + b[i];
+}
+
+// dst += src * gain, the gain and the sum in a single pass
+template <class T>
+inline void addScaled(T* dst, const T* src, size_t n, T gain) {
+  for (size_t i = 0; i < n; ++i) dst[i] += src[i] * gain;
+}
+
+// dst += a * gainA + b * gainB, two inputs mixed in a single pass
+template <class T>
+inline void addScaled2(T* dst, const T* a, T gainA, const T* b, T gainB, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] += a[i] * gainA + b[i] * gainB;
+}
+
+// dst = (dst + src) * gain
+template <class T>
+inline void addAndScale(T* dst, const T* src, size_t n, T gain) {
+  for (size_t i = 0; i < n; ++i) dst[i] = (dst[i] + src[i]) * gain;
+}
+
+template <class T>
+inline double sum(const T* src, size_t n) {
+  double acc = 0;
+  for (size_t i = 0; i < n; ++i) acc += src[i];
+  return acc;
+}
+
+// sum of a * b, the taps of a filter against its input
+template <class T>
+inline T dot(const T* a, const T* b, size_t n) {
+  T acc = T(0);
+  for (size_t i = 0; i < n; ++i) acc += a[i] * b[i];
+  return acc;
+}
+
+// min, max, peak, sums and clipped samples in a single pass
+template <class T>
+inline void statistics(const T* src, size_t n, T clipLevel, StatisticsC<T>* out) {
+  StatisticsC<T> stats;
+  if (n > 0) {
+    stats.min = stats.max = src[0];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const T x = src[i];
+    const T a = std::fabs(x);
+    stats.min = std::min(stats.min, x);
+    stats.max = std::max(stats.max, x);
+    if (a > stats.peak) {
+      stats.peak = a;
+      stats.peakIndex = i;
+    }
+    stats.sum += x;
+    stats.sumOfSquares += (double)x * x;
+    stats.clipped += a >= clipLevel;
+  }
+  stats.length = n;
+  *out = stats;
+}
+
+// minimum and maximum in a single pass, both 0 if n is 0
+template <class T>
+inline void minMax(const T* src, size_t n, T* min, T* max) {
+  if (n == 0) {
+    *min = *max = T(0);
+    return;
+  }
+  T lo = src[0], hi = src[0];
+  for (size_t i = 1; i < n; ++i) {
+    lo = std::min(lo, src[i]);
+    hi = std::max(hi, src[i]);
+  }
+  *min = lo;
+  *max = hi;
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ASU_KERNELS_SSE2
+namespace sse2 {
+
+ASU_TARGET_SSE2 inline void scale(float* dst, size_t n, float gain) {
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), g));
+  }
+  scalar::scale(dst + i, n - i, gain);
+}
+
+ASU_TARGET_SSE2 inline void offset(float* dst, size_t n, float value) {
+  const __m128 v = _mm_set1_ps(value);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), v));
+  }
+  scalar::offset(dst + i, n - i, value);
+}
+
+ASU_TARGET_SSE2 inline void add(float* dst, const float* src, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+  }
+  scalar::add(dst + i, src + i, n - i);
+}
+
+ASU_TARGET_SSE2 inline void add3(float* dst, const float* a, const float* b, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+  scalar::add(dst + i, a + i, b + i, n - i);
+}
+
+ASU_TARGET_SSE2 inline void addScaled(float* dst, const float* src, size_t n, float gain) {
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 s = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), s));
+  }
+  scalar::addScaled(dst + i, src + i, n - i, gain);
+}
+
+ASU_TARGET_SSE2 inline void addScaled2(float* dst, const float* a, float gainA, const float* b, float gainB, size_t n) {
+  const __m128 ga = _mm_set1_ps(gainA);
+  const __m128 gb = _mm_set1_ps(gainB);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), ga), _mm_mul_ps(_mm_loadu_ps(b + i), gb));
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), s));
+  }
+  scalar::addScaled2(dst + i, a + i, gainA, b + i, gainB, n - i);
+}
+
+ASU_TARGET_SSE2 inline void addAndScale(float* dst, const float* src, size_t n, float gain) {
+  const __m128 g = _mm_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 s = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(s, g));
+  }
+  scalar::addAndScale(dst + i, src + i, n - i, gain);
+}
+
+ASU_TARGET_SSE2 inline double sum(const float* src, size_t n) {
+  // accumulating in double keeps long files accurate
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(src + i);
+    acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(v));
+    acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+  return lanes[0] + lanes[1] + scalar::sum(src + i, n - i);
+}
+
+ASU_TARGET_SSE2 inline float dot(const float* a, const float* b, size_t n) {
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + scalar::dot(a + i, b + i, n - i);
+}
+
+// the lanes of a vector statistics pass, folded into one result
+inline void foldStatistics(const float* mins, const float* maxs, const float* peaks, const int32_t* indices,
+  const int32_t* clipped, size_t lanes, double sum, double sumOfSquares, size_t n, StatisticsC<float>* out) {
+  StatisticsC<float> stats;
+  stats.min = mins[0];
+  stats.max = maxs[0];
+  stats.peak = peaks[0];
+  stats.peakIndex = (size_t)indices[0];
+  for (size_t l = 0; l < lanes; ++l) {
+    stats.min = std::min(stats.min, mins[l]);
+    stats.max = std::max(stats.max, maxs[l]);
+    if (peaks[l] > stats.peak || (peaks[l] == stats.peak && (size_t)indices[l] < stats.peakIndex)) {
+      stats.peak = peaks[l];
+      stats.peakIndex = (size_t)indices[l];
+    }
+    stats.clipped += (size_t)clipped[l];
+  }
+  stats.sum = sum;
+  stats.sumOfSquares = sumOfSquares;
+  stats.length = n;
+  *out = stats;
+}
+
+// the sums run in float for a block at most, then go into the double totals
+const size_t kStatisticsBlock = 1024;
+
+ASU_TARGET_SSE2 inline void statistics(const float* src, size_t n, float clipLevel, StatisticsC<float>* out) {
+  if (n < 4) {
+    scalar::statistics(src, n, clipLevel, out);
+    return;
+  }
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  const __m128 clip = _mm_set1_ps(clipLevel);
+  const __m128i step = _mm_set1_epi32(4);
+  __m128 vmin = _mm_loadu_ps(src), vmax = vmin, vpeak = _mm_setzero_ps();
+  __m128i index = _mm_setr_epi32(0, 1, 2, 3), peakIndex = index, clipped = _mm_setzero_si128();
+  double sum = 0, sumOfSquares = 0;
+  const size_t vectorEnd = n - n % 4;
+  size_t i = 0;
+  while (i < vectorEnd) {
+    const size_t blockEnd = std::min(vectorEnd, i + kStatisticsBlock);
+    __m128 blockSum = _mm_setzero_ps(), blockSquares = _mm_setzero_ps();
+    for (; i < blockEnd; i += 4) {
+      const __m128 v = _mm_loadu_ps(src + i);
+      const __m128 a = _mm_and_ps(v, absMask);
+      vmin = _mm_min_ps(vmin, v);
+      vmax = _mm_max_ps(vmax, v);
+      const __m128i greater = _mm_castps_si128(_mm_cmpgt_ps(a, vpeak));
+      vpeak = _mm_max_ps(vpeak, a);
+      peakIndex = _mm_or_si128(_mm_and_si128(greater, index), _mm_andnot_si128(greater, peakIndex));
+      index = _mm_add_epi32(index, step);
+      clipped = _mm_sub_epi32(clipped, _mm_castps_si128(_mm_cmpge_ps(a, clip)));
+      blockSum = _mm_add_ps(blockSum, v);
+      blockSquares = _mm_add_ps(blockSquares, _mm_mul_ps(v, v));
+    }
+    float sums[4], squares[4];
+    _mm_storeu_ps(sums, blockSum);
+    _mm_storeu_ps(squares, blockSquares);
+    sum += (double)(sums[0] + sums[1]) + (sums[2] + sums[3]);
+    sumOfSquares += (double)(squares[0] + squares[1]) + (squares[2] + squares[3]);
+  }
+  float mins[4], maxs[4], peaks[4];
+  int32_t indices[4], clips[4];
+  _mm_storeu_ps(mins, vmin);
+  _mm_storeu_ps(maxs, vmax);
+  _mm_storeu_ps(peaks, vpeak);
+  _mm_storeu_si128((__m128i*)indices, peakIndex);
+  _mm_storeu_si128((__m128i*)clips, clipped);
+  foldStatistics(mins, maxs, peaks, indices, clips, 4, sum, sumOfSquares, vectorEnd, out);
+  StatisticsC<float> tail;
+  scalar::statistics(src + vectorEnd, n - vectorEnd, clipLevel, &tail);
+  out->append(tail);
+}
+
+ASU_TARGET_SSE2 inline void minMax(const float* src, size_t n, float* min, float* max) {
+  if (n < 4) {
+    scalar::minMax(src, n, min, max);
+    return;
+  }
+  __m128 lo = _mm_loadu_ps(src);
+  __m128 hi = lo;
+  size_t i = 4;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(src + i);
+    lo = _mm_min_ps(lo, v);
+    hi = _mm_max_ps(hi, v);
+  }
+  float los[4], his[4];
+  _mm_storeu_ps(los, lo);
+  _mm_storeu_ps(his, hi);
+  float l = std::min(std::min(los[0], los[1]), std::min(los[2], los[3]));
+  float h = std::max(std::max(his[0], his[1]), std::max(his[2], his[3]));
+  for (; i < n; ++i) {
+    l = std::min(l, src[i]);
+    h = std::max(h, src[i]);
+  }
+  *min = l;
+  *max = h;
+}
+
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ASU_KERNELS_AVX2
+namespace avx2 {
+
+ASU_TARGET_AVX2 inline void scale(float* dst, size_t n, float gain) {
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), g));
+  }
+  scalar::scale(dst + i, n - i, gain);
+}
+
+ASU_TARGET_AVX2 inline void offset(float* dst, size_t n, float value) {
+  const __m256 v = _mm256_set1_ps(value);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), v));
+  }
+  scalar::offset(dst + i, n - i, value);
+}
+
+ASU_TARGET_AVX2 inline void add(float* dst, const float* src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+  }
+  scalar::add(dst + i, src + i, n - i);
+}
+
+ASU_TARGET_AVX2 inline void add3(float* dst, const float* a, const float* b, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+  scalar::add(dst + i, a + i, b + i, n - i);
+}
+
+ASU_TARGET_AVX2 inline void addScaled(float* dst, const float* src, size_t n, float gain) {
+  // no FMA on purpose, so that the result doesn't depend on the CPU
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src + i), g);
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), s));
+  }
+  scalar::addScaled(dst + i, src + i, n - i, gain);
+}
+
+ASU_TARGET_AVX2 inline void addScaled2(float* dst, const float* a, float gainA, const float* b, float gainB, size_t n) {
+  const __m256 ga = _mm256_set1_ps(gainA);
+  const __m256 gb = _mm256_set1_ps(gainB);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a + i), ga), _mm256_mul_ps(_mm256_loadu_ps(b + i), gb));
+    _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), s));
+  }
+  scalar::addScaled2(dst + i, a + i, gainA, b + i, gainB, n - i);
+}
+
+ASU_TARGET_AVX2 inline void addAndScale(float* dst, const float* src, size_t n, float gain) {
+  const __m256 g = _mm256_set1_ps(gain);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 s = _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(s, g));
+  }
+  scalar::addAndScale(dst + i, src + i, n - i, gain);
+}
+
+ASU_TARGET_AVX2 inline double sum(const float* src, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(src + i);
+    acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + scalar::sum(src + i, n - i);
+}
+
+ASU_TARGET_AVX2 inline float dot(const float* a, const float* b, size_t n) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+  }
+  __m256 acc = _mm256_add_ps(acc0, acc1);
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  float lanes[4];
+  _mm_storeu_ps(lanes, half);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + scalar::dot(a + i, b + i, n - i);
+}
+
+ASU_TARGET_AVX2 inline void statistics(const float* src, size_t n, float clipLevel, StatisticsC<float>* out) {
+  if (n < 8) {
+    scalar::statistics(src, n, clipLevel, out);
+    return;
+  }
+  const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  const __m256 clip = _mm256_set1_ps(clipLevel);
+  const __m256i step = _mm256_set1_epi32(8);
+  __m256 vmin = _mm256_loadu_ps(src), vmax = vmin, vpeak = _mm256_setzero_ps();
+  __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), peakIndex = index, clipped = _mm256_setzero_si256();
+  double sum = 0, sumOfSquares = 0;
+  const size_t vectorEnd = n - n % 8;
+  size_t i = 0;
+  while (i < vectorEnd) {
+    const size_t blockEnd = std::min(vectorEnd, i + sse2::kStatisticsBlock);
+    __m256 blockSum = _mm256_setzero_ps(), blockSquares = _mm256_setzero_ps();
+    for (; i < blockEnd; i += 8) {
+      const __m256 v = _mm256_loadu_ps(src + i);
+      const __m256 a = _mm256_and_ps(v, absMask);
+      vmin = _mm256_min_ps(vmin, v);
+      vmax = _mm256_max_ps(vmax, v);
+      const __m256i greater = _mm256_castps_si256(_mm256_cmp_ps(a, vpeak, _CMP_GT_OQ));
+      vpeak = _mm256_max_ps(vpeak, a);
+      peakIndex = _mm256_blendv_epi8(peakIndex, index, greater);
+      index = _mm256_add_epi32(index, step);
+      clipped = _mm256_sub_epi32(clipped, _mm256_castps_si256(_mm256_cmp_ps(a, clip, _CMP_GE_OQ)));
+      blockSum = _mm256_add_ps(blockSum, v);
+      blockSquares = _mm256_add_ps(blockSquares, _mm256_mul_ps(v, v));
+    }
+    float sums[8], squares[8];
+    _mm256_storeu_ps(sums, blockSum);
+    _mm256_storeu_ps(squares, blockSquares);
+    for (size_t l = 0; l < 8; ++l) {
+      sum += sums[l];
+      sumOfSquares += squares[l];
+    }
+  }
+  float mins[8], maxs[8], peaks[8];
+  int32_t indices[8], clips[8];
+  _mm256_storeu_ps(mins, vmin);
+  _mm256_storeu_ps(maxs, vmax);
+  _mm256_storeu_ps(peaks, vpeak);
+  _mm256_storeu_si256((__m256i*)indices, peakIndex);
+  _mm256_storeu_si256((__m256i*)clips, clipped);
+  sse2::foldStatistics(mins, maxs, peaks, indices, clips, 8, sum, sumOfSquares, vectorEnd, out);
+  StatisticsC<float> tail;
+  scalar::statistics(src + vectorEnd, n - vectorEnd, clipLevel, &tail);
+  out->append(tail);
+}
+
+ASU_TARGET_AVX2 inline void minMax(const float* src, size_t n, float* min, float* max) {
+  if (n < 8) {
+    scalar::minMax(src, n, min, max);
+    return;
+  }
+  __m256 lo = _mm256_loadu_ps(src);
+  __m256 hi = lo;
+  size_t i = 8;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(src + i);
+    lo = _mm256_min_ps(lo, v);
+    hi = _mm256_max_ps(hi, v);
+  }
+  float los[8], his[8];
+  _mm256_storeu_ps(los, lo);
+  _mm256_storeu_ps(his, hi);
+  float l = los[0], h = his[0];
+  for (int k = 1; k < 8; ++k) {
+    l = std::min(l, los[k]);
+    h = std::max(h, his[k]);
+  }
+  for (; i < n; ++i) {
+    l = std::min(l, src[i]);
+    h = std::max(h, src[i]);
+  }
+  *min = l;
+  *max = h;
+}
+
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Runtime dispatch
+////////////////////////////////////////////////////////////////////////////////
+
+struct KernelTable {
+  void (*scale)(float*, size_t, float);
+  void (*offset)(float*, size_t, float);
+  void (*add)(float*, const float*, size_t);
+  void (*add3)(float*, const float*, const float*, size_t);
+  void (*addScaled)(float*, const float*, size_t, float);
+  void (*addScaled2)(float*, const float*, float, const float*, float, size_t);
+  void (*addAndScale)(float*, const float*, size_t, float);
+  double (*sum)(const float*, size_t);
+  float (*dot)(const float*, const float*, size_t);
+  void (*minMax)(const float*, size_t, float*, float*);
+  void (*statistics)(const float*, size_t, float, StatisticsC<float>*);
+  const char* name;
+};
+
+// whether the kernels for an instruction set are compiled in and this CPU
+// runs them, for the other modules that pick their own vector code
+inline bool hasSse2() {
+  #if defined(ASU_KERNELS_SSE2) && defined(__GNUC__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse2");
+  #elif defined(ASU_KERNELS_SSE2)
+  return true;
+  #else
+  return false;
+  #endif
+}
+
+inline bool hasAvx2() {
+  #ifdef ASU_KERNELS_AVX2
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+  #else
+  return false;
+  #endif
+}
+
+namespace detail {
+
+inline void scalarAdd3(float* dst, const float* a, const float* b, size_t n) {
+  scalar::add(dst, a, b, n);
+}
+
+inline KernelTable selectKernels() {
+  KernelTable table = {
+    &scalar::scale<float>,
+    &scalar::offset<float>,
+    &scalar::add<float>,
+    &scalarAdd3,
+    &scalar::addScaled<float>,
+    &scalar::addScaled2<float>,
+    &scalar::addAndScale<float>,
+    &scalar::sum<float>,
+    &scalar::dot<float>,
+    &scalar::minMax<float>,
+    &scalar::statistics<float>,
+    "scalar"
+  };
+  #ifdef ASU_KERNELS_SSE2
+  if (hasSse2()) {
+    KernelTable sse = {
+      &sse2::scale, &sse2::offset, &sse2::add, &sse2::add3,
+      &sse2::addScaled, &sse2::addScaled2, &sse2::addAndScale, &sse2::sum, &sse2::dot, &sse2::minMax, &sse2::statistics,
+      "sse2"
+    };
+    table = sse;
+  }
+  #endif
+  #ifdef ASU_KERNELS_AVX2
+  if (hasAvx2()) {
+    KernelTable avx = {
+      &avx2::scale, &avx2::offset, &avx2::add, &avx2::add3,
+      &avx2::addScaled, &avx2::addScaled2, &avx2::addAndScale, &avx2::sum, &avx2::dot, &avx2::minMax, &avx2::statistics,
+      "avx2"
+    };
+    table = avx;
+  }
+  #endif
+  return table;
+}
+
+}
+
+// the kernels for this CPU, selected on the first call
+inline const KernelTable& table() {
+  static const KernelTable kernels = detail::selectKernels();
+  return kernels;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Entry points: the generic versions are scalar, float goes through the table
+////////////////////////////////////////////////////////////////////////////////
+
+template <class T> inline void scale(T* dst, size_t n, T gain) { scalar::scale(dst, n, gain); }
+template <class T> inline void offset(T* dst, size_t n, T value) { scalar::offset(dst, n, value); }
+template <class T> inline void add(T* dst, const T* src, size_t n) { scalar::add(dst, src, n); }
+template <class T> inline void add(T* dst, const T* a, const T* b, size_t n) { scalar::add(dst, a, b, n); }
+template <class T> inline void addScaled(T* dst, const T* src, size_t n, T gain) { scalar::addScaled(dst, src, n, gain); }
+template <class T> inline void addScaled2(T* dst, const T* a, T gainA, const T* b, T gainB, size_t n) { scalar::addScaled2(dst, a, gainA, b, gainB, n); }
+template <class T> inline void addAndScale(T* dst, const T* src, size_t n, T gain) { scalar::addAndScale(dst, src, n, gain); }
+template <class T> inline double sum(const T* src, size_t n) { return scalar::sum(src, n); }
+template <class T> inline T dot(const T* a, const T* b, size_t n) { return scalar::dot(a, b, n); }
+template <class T> inline void minMax(const T* src, size_t n, T* min, T* max) { scalar::minMax(src, n, min, max); }
+template <class T> inline void statistics(const T* src, size_t n, T clipLevel, StatisticsC<T>* out) { scalar::statistics(src, n, clipLevel, out); }
+
+inline void scale(float* dst, size_t n, float gain) { table().scale(dst, n, gain); }
+inline void offset(float* dst, size_t n, float value) { table().offset(dst, n, value); }
+inline void add(float* dst, const float* src, size_t n) { table().add(dst, src, n); }
+inline void add(float* dst, const float* a, const float* b, size_t n) { table().add3(dst, a, b, n); }
+inline void addScaled(float* dst, const float* src, size_t n, float gain) { table().addScaled(dst, src, n, gain); }
+inline void addScaled2(float* dst, const float* a, float gainA, const float* b, float gainB, size_t n) { table().addScaled2(dst, a, gainA, b, gainB, n); }
+inline void addAndScale(float* dst, const float* src, size_t n, float gain) { table().addAndScale(dst, src, n, gain); }
+inline double sum(const float* src, size_t n) { return table().sum(src, n); }
+inline float dot(const float* a, const float* b, size_t n) { return table().dot(a, b, n); }
+inline void minMax(const float* src, size_t n, float* min, float* max) { table().minMax(src, n, min, max); }
+
+// the vector versions keep the peak index in 32 bits, longer runs go in pieces
+inline void statistics(const float* src, size_t n, float clipLevel, Statistics* out) {
+  const size_t piece = (size_t)1 << 30;
+  table().statistics(src, std::min(n, piece), clipLevel, out);
+  for (size_t start = piece; start < n; start += piece) {
+    Statistics next;
+    table().statistics(src + start, std::min(piece, n - start), clipLevel, &next);
+    out->append(next);
+  }
+}
+
+// largest absolute value, from a single min/max pass
+template <class T>
+inline T peak(const T* src, size_t n) {
+  T lo, hi;
+  minMax(src, n, &lo, &hi);
+  return std::max(std::fabs(lo), std::fabs(hi));
+}
+
+}
+}
+
+#endif /* VectorKernels_h */
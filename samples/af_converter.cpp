@@ -1,50 +1,239 @@
-
 #include <iostream>
+#include <fstream>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "../include/AudioFormatsManager.hpp"
 #include "../include/StringUtilities.h"
 
 using namespace asu;
 using namespace assets;
 
-int main (int argc, char** argv) {
-  if (argc < 3 || argc >4 || (argc == 4 && strcmp(argv[3], "-v") != 0)) {
-    std::cout << "Usage: af_converter file.in file.out (-v)" << std::endl << std::endl;
+namespace {
+
+// Blocks the workers while the decoded audio in flight would exceed the
+// budget. A file bigger than the whole budget is let through alone.
+class MemoryBudget {
+public:
+  MemoryBudget(size_t bytes_) : m_budget(bytes_), m_inFlight(0) {}
+
+  void acquire(size_t bytes_) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_released.wait(lock, [&]() {
+      return m_inFlight == 0 || m_inFlight + bytes_ <= m_budget;
+    });
+    m_inFlight += bytes_;
+  }
+
+  void release(size_t bytes_) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_inFlight -= bytes_;
+    }
+    m_released.notify_all();
+  }
+
+  size_t getBudget() const { return m_budget; }
+private:
+  size_t m_budget;
+  size_t m_inFlight;
+  std::mutex m_mutex;
+  std::condition_variable m_released;
+};
+
+struct BatchJob {
+  std::string input;
+  std::string output;
+};
+
+struct BatchStats {
+  BatchStats() : converted(0), failed(0), audioSeconds(0.0), inputBytes(0) {}
+  size_t converted;
+  size_t failed;
+  double audioSeconds;
+  unsigned long long inputBytes;
+};
+
+std::string removeTrailingSlash(std::string path_) {
+  while (path_.size() > 1 && path_[path_.size() - 1] == '/') {
+    path_.erase(path_.size() - 1);
+  }
+  return path_;
+}
+
+// like mkdir -p, never empties a folder that already exists
+void createDirectories(const std::string& path_) {
+  std::string partial;
+  for (auto& token : utilities::tokenize(path_, "/")) {
+    partial += (partial.empty() && !utilities::isAbsolute(path_)) ? token : "/" + token;
+    utilities::createDirectory(partial, false);
+  }
+}
+
+bool isDirectory(const std::string& path_) {
+  struct stat st;
+  return stat(path_.c_str(), &st) == 0 && (st.st_mode & S_IFDIR) != 0;
+}
+
+// the input is either a folder, scanned recursively, or a text file listing one path per line
+bool collectJobs(const std::string& input_, const std::string& outputDir_, const std::string& extension_, std::vector<BatchJob>& jobs_) {
+  std::vector<std::string> paths;
+  std::string root;
+  if (isDirectory(input_)) {
+    root = removeTrailingSlash(input_);
+    if (utilities::getFilesInDirectory(paths, root, "") != 0) {
+      return false;
+    }
+  } else {
+    std::ifstream list(input_);
+    if (!list.is_open()) {
+      std::cerr << "Unable to open the file list " << input_ << std::endl;
+      return false;
+    }
+    std::string line;
+    while (!utilities::safeGetline(list, line).eof()) {
+      utilities::trim(line);
+      if (!line.empty()) {
+        paths.push_back(line);
+      }
+    }
+  }
+  for (auto& path : paths) {
+    if (extensionToAudioFormat(utilities::getFileExtension(path).c_str()) == ASU_FORMAT_UNKNOWN) {
+      continue;
+    }
+    // folders keep their structure in the output, lists are flattened
+    std::string relativeDir;
+    if (!root.empty()) {
+      relativeDir = utilities::getFilePathWithoutFilename(path.substr(root.size()));
+    }
+    BatchJob job;
+    job.input = path;
+    job.output = removeTrailingSlash(outputDir_) + (relativeDir.empty() ? "/" : relativeDir) +
+      utilities::getFilenameFromPath(path, true) + "." + extension_;
+    jobs_.push_back(job);
+  }
+  return true;
+}
+
+int convertBatch(const std::string& input_, const std::string& outputDir_, const std::string& extension_,
+  unsigned int numberOfThreads_, size_t memoryBudget_, bool verbose_) {
+  AudioFormatTypes outFormat = extensionToAudioFormat(extension_.c_str());
+  if (outFormat == ASU_FORMAT_UNKNOWN) {
+    std::cerr << "Invalid output format" << std::endl;
     return 1;
   }
-  bool verbose = (argc == 4);
+  std::vector<BatchJob> jobs;
+  if (!collectJobs(input_, outputDir_, extension_, jobs)) {
+    std::cerr << "Problem with input " << input_ << std::endl;
+    return 1;
+  }
+  numberOfThreads_ = std::max(1U, std::min(numberOfThreads_, (unsigned int)jobs.size()));
+  std::cout << "Converting " << jobs.size() << " files with " << numberOfThreads_ << " threads" << std::endl;
+
+  MemoryBudget budget(memoryBudget_);
+  BatchStats stats;
+  std::mutex statsMutex;
+  std::atomic<size_t> nextJob(0);
+  // one manager for every worker, so the probe cache is shared too
+  AudioFormatsManager afm;
+
+  auto worker = [&]() {
+    size_t index;
+    while ((index = nextJob++) < jobs.size()) {
+      const BatchJob& job = jobs[index];
+      AudioFormatTypes inFormat;
+      float samplingRate;
+      unsigned int numberOfChannels, bitsPerChannel;
+      unsigned long length;
+      // files that can't tell their length in advance run on their own
+      size_t reserved = budget.getBudget();
+      if (afm.getFileInfo(job.input, inFormat, samplingRate, numberOfChannels, bitsPerChannel, length)) {
+        reserved = (size_t)length * numberOfChannels * sizeof(float);
+      }
+      budget.acquire(reserved);
+      bool success;
+      double seconds = 0.0;
+      {
+        AudioBuffer buffer;
+        success = afm.loadFile(job.input, buffer, samplingRate);
+        if (success) {
+          createDirectories(job.output.substr(0, job.output.rfind('/')));
+          success = afm.writeFile(job.output, buffer, samplingRate, outFormat);
+          seconds = (double)buffer.size / samplingRate;
+        }
+      }
+      budget.release(reserved);
+
+      std::lock_guard<std::mutex> lock(statsMutex);
+      if (success) {
+        ++stats.converted;
+        stats.audioSeconds += seconds;
+        stats.inputBytes += utilities::GetFileSize(job.input);
+        if (verbose_) {
+          std::cout << "Converted " << job.input << " -> " << job.output << std::endl;
+        }
+      } else {
+        ++stats.failed;
+        std::cerr << "Problem converting " << job.input << std::endl;
+      }
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < numberOfThreads_; ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+  elapsed = std::max(elapsed, 0.001);
+
+  std::cout << "Converted " << stats.converted << " files, " << stats.failed << " failed" << std::endl;
+  std::cout << "Elapsed: " << elapsed << " s." << std::endl;
+  std::cout << "Throughput: " << stats.converted / elapsed << " files/s, " <<
+    stats.inputBytes / (1024.0 * 1024.0) / elapsed << " MB/s" << std::endl;
+  std::cout << "Realtime factor: " << stats.audioSeconds / elapsed << "x" << std::endl;
+  return stats.failed == 0 ? 0 : 1;
+}
+
+int convertFile(const char* input_, const char* output_, bool verbose) {
   AudioBuffer inBuf;
   AudioFormatsManager afm;
   float samplingRate;
-  std::string fileInString(argv[2]);
+  std::string fileInString(output_);
   AudioFormatTypes outFormat = extensionToAudioFormat(utilities::getFileExtension(fileInString).c_str());
-  
+
   if (outFormat == assets::ASU_FORMAT_UNKNOWN) {
     std::cerr << "Invalid output format" << std::endl;
     return 1;
   }
-  
+
   auto start = std::chrono::system_clock::now();
-  
-  if (!afm.loadFile(argv[1], inBuf, samplingRate)) {
+
+  if (!afm.loadFile(input_, inBuf, samplingRate)) {
     std::cerr << "Problem with input file" << std::endl;
     return 1;
   }
-  
+
   auto read = std::chrono::system_clock::now();
-  
-  if (!afm.writeFile (argv[2], inBuf, samplingRate, outFormat)) {
+
+  if (!afm.writeFile (output_, inBuf, samplingRate, outFormat)) {
     std::cerr << "Problem with output file" << std::endl;
     return 1;
   }
-  
+
   auto delim = std::string("/");
   auto filename = utilities::tokenize(fileInString, delim);
   std::cout << "Converting file " << filename[filename.size() - 1] << std::endl;
-  
+
   auto write = std::chrono::system_clock::now();
-  
-  
+
+
   if (verbose) {
     auto milliCount1 = (std::chrono::duration_cast<std::chrono::milliseconds>(read - start).count() / 1000.F);
     auto milliCount2 = (std::chrono::duration_cast<std::chrono::milliseconds>(write - read).count() / 1000.F);
@@ -57,4 +246,35 @@ int main (int argc, char** argv) {
   return 0;
 }
 
+void printUsage() {
+  std::cout << "Usage: af_converter file.in file.out (-v)" << std::endl;
+  std::cout << "       af_converter -b folder|list.txt outfolder extension (-j threads) (-m megabytes) (-v)" << std::endl << std::endl;
+}
+
+}
 
+int main (int argc, char** argv) {
+  if (argc >= 5 && strcmp(argv[1], "-b") == 0) {
+    unsigned int numberOfThreads = std::max(1U, std::thread::hardware_concurrency());
+    size_t megabytes = 1024;
+    bool verbose = false;
+    for (int i = 5; i < argc; ++i) {
+      if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+        numberOfThreads = std::max(1, atoi(argv[++i]));
+      } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+        megabytes = std::max(1, atoi(argv[++i]));
+      } else if (strcmp(argv[i], "-v") == 0) {
+        verbose = true;
+      } else {
+        printUsage();
+        return 1;
+      }
+    }
+    return convertBatch(argv[2], argv[3], argv[4], numberOfThreads, megabytes * 1024 * 1024, verbose);
+  }
+  if (argc < 3 || argc >4 || (argc == 4 && strcmp(argv[3], "-v") != 0)) {
+    printUsage();
+    return 1;
+  }
+  return convertFile(argv[1], argv[2], argc == 4);
+}
@@ -235,7 +235,7 @@ bool AudioFormat_CoreAudio::loadFile(const std::string& path,
   delete convertedData;
   ExtAudioFileDispose(audioFileObject);
   // IMPORTANT: set the isReady flag to true
-  buffer.isSilent = false;
+  buffer.markAsWritten();
   return true;
 }
 
@@ -39,41 +39,36 @@
 
 #include "AudioFormat_aac.hpp"
 #include <iostream>
-#include <list>
+#include <mutex>
+#include "SampleConversion.h"
 #include "libAACenc/include/aacenc_lib.h"
 #include "libAACdec/include/aacdecoder_lib.h"
 #include "libMpegTPDec/include/mpegFileRead.h"
 #include "libSYS/include/wav_file.h"
 
-static bool aacCopyrightWritten = false;
+static std::once_flag aacCopyrightWritten;
 
 void FDKAacCopyright()
 {
-  if (aacCopyrightWritten) return;
-  std::cout << std::endl <<
-    "Using AAC file IO: " << std::endl <<
-    "The Fraunhofer FDK AAC Codec Library for Android" << std::endl <<
-    "© Copyright  1995 - 2012 Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V." << std::endl <<
-    "All rights reserved."
-    << std::endl << std::endl;
-  aacCopyrightWritten = true;
+  std::call_once(aacCopyrightWritten, []() {
+    std::cout << std::endl <<
+      "Using AAC file IO: " << std::endl <<
+      "The Fraunhofer FDK AAC Codec Library for Android" << std::endl <<
+      "© Copyright  1995 - 2012 Fraunhofer-Gesellschaft zur Förderung der angewandten Forschung e.V." << std::endl <<
+      "All rights reserved."
+      << std::endl << std::endl;
+  });
 }
 
 
 
-namespace dinahmoe {
+namespace asu {
 namespace assets {
 
 AudioFormat_aac::AudioFormat_aac() {
   FDKAacCopyright();
-  m_supportedFormatsForReading.push_back(DM_FORMAT_AAC);
-  m_supportedFormatsForWriting.push_back(DM_FORMAT_AAC);
-}
-
-AudioFormat_aac::~AudioFormat_aac() {
-  for (auto buf: m_buffers) {
-    delete [] buf.ptr;
-  }
+  m_supportedFormatsForReading.push_back(ASU_FORMAT_AAC);
+  m_supportedFormatsForWriting.push_back(ASU_FORMAT_AAC);
 }
 
 /*
@@ -85,115 +80,503 @@ AudioFormat_aac::~AudioFormat_aac() {
 
 #define BUFFER_IN_SIZE 1024
 #define BUFFER_OUT_SIZE 20480
-#define AAC_EMPTY_SAMPLES_START 2110
-#define AAC_EMPTY_SAMPLES_END 824
-#define AAC_EMPTY_SAMPLES_TOTAL (AAC_EMPTY_SAMPLES_START + AAC_EMPTY_SAMPLES_END)
+// The fdk encoder primes the stream with two frames of silence. ADTS has no
+// field for it, so this is what we assume for every file
+#define AAC_ENCODER_DELAY_FRAMES 2
 
-  // pass a ptr to AudioFormat if you wanna know the format of the decoded file
-bool AudioFormat_aac::loadFile(const std::string& path_,
-  AudioBuffer& buffer_,
-  float& samplingRate_,
-  void** formatDetail_) {
-  HANDLE_AACDECODER handle;
-  int channels;
-  handle = aacDecoder_Open(TT_MP4_ADTS,1);
-  FILE* aacFile = fopen(path_.c_str() ,"rb");
-  if (aacFile == NULL) {
-    std::cerr << "Problems opening file " << path_ << std::endl;
-    return false;
-  }
-  UCHAR *inBuffer = (UCHAR*)malloc(2048);
-  int readLen = -1;
-  UINT bytesValid = 0;
-  INT_PCM outBuffer[20480];
-  int firstFrame = 1;
-  int total = 0;
-  int numberOfInputFrames = 0;
-  std::list<DecodedBuffer>::iterator lastBufferIt = m_buffers.begin();
-  INT_PCM* writingBuf;
-  while(readLen != 0)
-  {
-    if (bytesValid != 2048) {
-      readLen = fread((void*)(inBuffer + bytesValid) , 1, 2048 - bytesValid ,aacFile);
-    }
-    bytesValid = readLen;
-    total += readLen;
-    aacDecoder_Fill(handle, &inBuffer, (const UINT*)&readLen, &bytesValid);
-    AAC_DECODER_ERROR errStatus;
-    while ((errStatus = aacDecoder_DecodeFrame(handle, outBuffer, 20480 ,0)) != AAC_DEC_NOT_ENOUGH_BITS) {
-      CStreamInfo* info = aacDecoder_GetStreamInfo(handle);
-      if (firstFrame == 1) {
-        firstFrame = 0;
-        samplingRate_ = info->aacSampleRate;
-        channels = info->numChannels;
-      }
-      // reuse the buffer on the back() of the list. there are 3 possibilities, in order:
-      // - we need to allocate buffers in the list because there are not enough (lastBufferIt is at the end of the list)
-      // - the buffer pointed by lastBufferIt can accomodate enough samples
-      // - the buffer pointed by lastBufferIt can't accomodate enough samples: we delete and realloc
-      // note that writingBuf at the end of the branch will point to the buffer after the last one used
-      // that is end() or before.
-      if (lastBufferIt == m_buffers.end()) {
-        writingBuf = new INT_PCM[info->frameSize * channels];
-        m_buffers.emplace_back(writingBuf, info->frameSize, info->frameSize * channels);
-        lastBufferIt = m_buffers.end();
-      } else {
-        if (lastBufferIt->allocatedSamples >= info->frameSize * channels) {
-          writingBuf = lastBufferIt->ptr;
-          lastBufferIt->usedFrames = info->frameSize;
-        } else {
-          delete [] lastBufferIt->ptr;
-          writingBuf = new INT_PCM[info->frameSize * channels];
-          lastBufferIt->usedFrames = lastBufferIt->allocatedSamples = info->frameSize * channels;
-        }
-        lastBufferIt++;
+namespace {
+
+// One entry for each ADTS frame of a file, so that we can seek without decoding
+typedef struct AdtsFrame_ {
+  AdtsFrame_(long offset_, unsigned long firstBlock_) :
+    offset(offset_), firstBlock(firstBlock_) {}
+  long offset;
+  // number of raw data blocks in the stream before this frame
+  unsigned long firstBlock;
+} AdtsFrame;
+
+// walks the ADTS headers of the stream, hopping from frame to frame without
+// reading the payloads. Returns the total number of raw data blocks
+unsigned long scanAdtsFrames(AudioInputStream& stream, std::vector<AdtsFrame>& frames) {
+  frames.clear();
+  unsigned long blocks = 0;
+  unsigned char header[7];
+  long offset = 0;
+  stream.seek(0);
+  while (stream.read(header, 7) == 7) {
+    if (header[0] != 0xFF || (header[1] & 0xF0) != 0xF0) {
+      // garbage or tags before the first frame, look for the syncword
+      if (!frames.empty()) {
+        break;
       }
-      memcpy((void*)writingBuf, (void*)outBuffer, info->frameSize * sizeof(INT_PCM) * channels);
-      numberOfInputFrames += info->frameSize;
+      stream.seek(++offset);
+      continue;
     }
+    long frameLength = ((header[3] & 0x03) << 11) | (header[4] << 3) | (header[5] >> 5);
+    if (frameLength < 7) {
+      break;
+    }
+    frames.emplace_back(offset, blocks);
+    blocks += (header[6] & 0x03) + 1;
+    offset += frameLength;
+    stream.seek(offset);
+  }
+  stream.seek(0);
+  return blocks;
+}
 
-    if (errStatus != AAC_DEC_OK) {
-      if (errStatus == AAC_DEC_NOT_ENOUGH_BITS) {
+// the length of the audio that went into the encoder, rounded up to a whole frame:
+// the padding at the end of the last frame can't be told apart from the signal
+unsigned long encodedLength(unsigned long blocks, unsigned long blockSize) {
+  return blocks > AAC_ENCODER_DELAY_FRAMES ? (blocks - AAC_ENCODER_DELAY_FRAMES) * blockSize : 0;
+}
+
+// the samples of the decoder are converted as int16_t
+static_assert(sizeof(INT_PCM) == sizeof(int16_t), "fdk-aac must be built with 16 bit PCM");
+
+// Each frame is decoded interleaved in m_outBuffer and deinterleaved from there
+// straight into the caller's channels. The decoded stream starts late by the
+// encoder priming plus the delay of the decoder itself, which we read from the
+// stream info; at the end of the input the decoder is flushed to get back the
+// audio that it still holds.
+class AudioFormatReader_aac : public AudioFormatReader {
+public:
+  AudioFormatReader_aac() :
+    m_handle(NULL),
+    m_inputLength(0),
+    m_bytesValid(0),
+    m_decodedStart(0),
+    m_decodedFrames(0),
+    m_framesToSkip(0),
+    m_decodeFlags(0),
+    m_inputEnded(false),
+    m_flushesLeft(0),
+    m_position(0),
+    m_priming(0),
+    m_outputDelay(0),
+    m_totalBlocks(0),
+    m_blockSize(0) {
+  }
+  ~AudioFormatReader_aac() { close(); }
+
+  bool open(const std::string& path) {
+    std::shared_ptr<FileInputStream> file(new FileInputStream());
+    if (!file->open(path)) {
+      std::cerr << "Problems opening file " << path << std::endl;
+      return false;
+    }
+    if (!openStream(file)) {
+      std::cerr << "Not able to decode file " << path << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool openStream(std::shared_ptr<AudioInputStream> stream) {
+    close();
+    m_stream = stream;
+    m_totalBlocks = scanAdtsFrames(*m_stream, m_frames);
+    m_handle = aacDecoder_Open(TT_MP4_ADTS, 1);
+    m_framesToSkip = 0;
+    // the first frame tells us the channels, the sampling rate and the delays
+    if (!decodeFrame()) {
+      close();
+      return false;
+    }
+    CStreamInfo* info = aacDecoder_GetStreamInfo(m_handle);
+    m_samplingRate = info->sampleRate;
+    m_numberOfChannels = info->numChannels;
+    m_blockSize = info->frameSize;
+    m_outputDelay = info->outputDelay;
+    m_priming = AAC_ENCODER_DELAY_FRAMES * m_blockSize + m_outputDelay;
+    m_flushesLeft = flushesNeeded();
+    m_channelPointers.resize(m_numberOfChannels);
+    m_length = encodedLength(m_totalBlocks, m_blockSize);
+    m_position = 0;
+    m_framesToSkip = m_priming;
+    skipDecodedFrames();
+    return true;
+  }
+
+  size_t readFrames(const AudioBufferView& view) {
+    if (m_handle == NULL) {
+      return 0;
+    }
+    assert(view.getNumberOfChannels() == m_numberOfChannels);
+    const size_t numFrames = std::min((size_t)view.getLength(), (size_t)(m_length - m_position));
+    size_t running = 0;
+    while (running < numFrames) {
+      if (m_decodedStart == m_decodedFrames) {
+        if (!decodeFrame()) {
+          break;
+        }
         continue;
       }
-      break;
+      size_t count = std::min(m_decodedFrames - m_decodedStart, numFrames - running);
+      const INT_PCM* in = &m_outBuffer[m_decodedStart * m_numberOfChannels];
+      for (unsigned int ch = 0; ch < m_numberOfChannels; ++ch) {
+        m_channelPointers[ch] = view[ch] + running;
+      }
+      conversion::deinterleave((const int16_t*)in, &m_channelPointers[0], m_numberOfChannels, count);
+      m_decodedStart += count;
+      running += count;
     }
+    m_position += running;
+    return running;
   }
-  fclose(aacFile);
-  // now setup the audiobuffer
-  long numberOfOutputFrames = numberOfInputFrames - AAC_EMPTY_SAMPLES_TOTAL;
-  long totalOutputSamples = numberOfOutputFrames * channels;
-  buffer_.resize(channels, numberOfOutputFrames); // 2934
-  std::list<DecodedBuffer>::iterator bufit = m_buffers.begin();
-  long currentOutputSample = 0;
-  
-  long inputRunningSum = 0;
-  long totalRunningSum = 0;
-  long inputSampleToStartAt = AAC_EMPTY_SAMPLES_START * channels;
-  float* outputStoragePtr = buffer_.getChannelData(0);
-  int samplesInThisBuffer = 0;
-  INT_PCM* inputPtr;
-  while (bufit != lastBufferIt) {
-    samplesInThisBuffer = bufit->usedFrames * channels;
-    inputPtr = bufit->ptr;
-    for (int i = 0; i < samplesInThisBuffer; ++i) {
-      if (++inputRunningSum < inputSampleToStartAt) {
-        continue;
+
+  // restarts decoding one ADTS frame before the one holding the target, so
+  // that the overlap of the filterbank is rebuilt, and drops what comes before
+  bool seek(unsigned long frame) {
+    if (m_handle == NULL || m_frames.empty() || frame > m_length) {
+      return false;
+    }
+    // the decoder delay is added by the decoder, the block comes from the encoder side
+    unsigned long targetBlock = (frame + AAC_ENCODER_DELAY_FRAMES * m_blockSize) / m_blockSize;
+    auto it = std::upper_bound(m_frames.begin(), m_frames.end(), targetBlock,
+      [](unsigned long block, const AdtsFrame& adts) { return block < adts.firstBlock; });
+    if (it == m_frames.begin()) {
+      return false;
+    }
+    --it;
+    if (it != m_frames.begin()) {
+      --it;
+    }
+    m_stream->seek(it->offset);
+    aacDecoder_SetParam(m_handle, AAC_TPDEC_CLEAR_BUFFER, 1);
+    m_decodeFlags = AACDEC_INTR;
+    m_inputLength = m_bytesValid = 0;
+    m_decodedStart = m_decodedFrames = 0;
+    m_inputEnded = false;
+    m_flushesLeft = flushesNeeded();
+    m_position = frame;
+    m_framesToSkip = frame + m_priming - it->firstBlock * m_blockSize;
+    return true;
+  }
+
+  void close() {
+    if (m_handle != NULL) {
+      aacDecoder_Close(m_handle);
+      m_handle = NULL;
+    }
+    m_stream.reset();
+    m_decodedStart = m_decodedFrames = 0;
+    m_inputLength = m_bytesValid = 0;
+    m_inputEnded = false;
+  }
+private:
+  // the flushes that bring out the audio delayed by the decoder
+  unsigned int flushesNeeded() const {
+    return m_blockSize ? (m_outputDelay + m_blockSize - 1) / m_blockSize : 0;
+  }
+
+  void skipDecodedFrames() {
+    size_t skipped = std::min(m_framesToSkip, m_decodedFrames - m_decodedStart);
+    m_framesToSkip -= skipped;
+    m_decodedStart += skipped;
+  }
+
+  // decodes one frame into m_outBuffer, false when there is nothing left
+  bool decodeFrame() {
+    AAC_DECODER_ERROR errStatus;
+    while (true) {
+      if (m_inputEnded) {
+        if (m_flushesLeft == 0) {
+          return false;
+        }
+        --m_flushesLeft;
+        errStatus = aacDecoder_DecodeFrame(m_handle, m_outBuffer, BUFFER_OUT_SIZE, AACDEC_FLUSH);
+        break;
+      }
+      // keep the buffer of the decoder topped up: checking the sync of the
+      // ADTS stream needs the headers of the frames that follow
+      if (m_bytesValid == 0) {
+        m_inputLength = m_stream->read(m_inBuffer, BUFFER_IN_SIZE);
+        m_bytesValid = m_inputLength;
       }
-      if (++totalRunningSum >= totalOutputSamples) {
+      if (m_bytesValid > 0) {
+        UCHAR* inPtr = m_inBuffer;
+        aacDecoder_Fill(m_handle, &inPtr, &m_inputLength, &m_bytesValid);
+      }
+      errStatus = aacDecoder_DecodeFrame(m_handle, m_outBuffer, BUFFER_OUT_SIZE, m_decodeFlags);
+      // on a sync error the decoder wants more data, just like when it runs out of bits
+      bool needsInput = errStatus == AAC_DEC_NOT_ENOUGH_BITS ||
+        (errStatus >= aac_dec_sync_error_start && errStatus <= aac_dec_sync_error_end);
+      if (!needsInput) {
         break;
       }
-      *(outputStoragePtr + currentOutputSample) = ((float)(*(inputPtr + i))) / 32767.F;
-      currentOutputSample += numberOfOutputFrames;
-      if (currentOutputSample >= totalOutputSamples) {
-        currentOutputSample %= totalOutputSamples;
-        ++currentOutputSample;
+      if (m_inputLength == 0) {
+        m_inputEnded = true;
       }
     }
-    ++bufit;
+    m_decodeFlags = 0;
+    if (errStatus != AAC_DEC_OK) {
+      return false;
+    }
+    CStreamInfo* info = aacDecoder_GetStreamInfo(m_handle);
+    m_decodedStart = 0;
+    m_decodedFrames = info->frameSize;
+    skipDecodedFrames();
+    return true;
   }
-  aacDecoder_Close(handle);
-  return true;
+
+  std::shared_ptr<AudioInputStream> m_stream;
+  HANDLE_AACDECODER m_handle;
+  UCHAR m_inBuffer[BUFFER_IN_SIZE];
+  UINT m_inputLength;
+  UINT m_bytesValid;
+  INT_PCM m_outBuffer[BUFFER_OUT_SIZE];
+  size_t m_decodedStart;
+  size_t m_decodedFrames;
+  std::vector<float*> m_channelPointers;
+  size_t m_framesToSkip;
+  UINT m_decodeFlags;
+  bool m_inputEnded;
+  unsigned int m_flushesLeft;
+  unsigned long m_position;
+  unsigned long m_priming;
+  unsigned long m_outputDelay;
+  std::vector<AdtsFrame> m_frames;
+  unsigned long m_totalBlocks;
+  unsigned long m_blockSize;
+};
+
+#define AAC_ENC_BITRATE 64000
+#define AAC_ENC_AOT 2
+#define AAC_ENC_AFTERBURNER 1
+#define AAC_ENC_ELD_SBR 0
+#define AAC_ENC_VBR 0
+
+// Frames are converted to interleaved 16 bits in m_convertBuffer and handed
+// to the encoder one AAC frame at a time, the bitstream goes straight to disk.
+class AudioFormatWriter_aac : public AudioFormatWriter {
+public:
+  AudioFormatWriter_aac() :
+    m_file(NULL),
+    m_handle(NULL),
+    m_numberOfChannels(0),
+    m_frameLength(0),
+    m_bufferedFrames(0) {
+  }
+  ~AudioFormatWriter_aac() { finalize(); }
+
+  bool open(const std::string& path,
+    const float samplingRate,
+    const unsigned int numberOfChannels,
+    const AudioFormatTypes format_,
+    const void* formatDetail_) {
+    finalize();
+    CHANNEL_MODE mode;
+    AACENC_InfoStruct info = { 0 };
+    switch (numberOfChannels) {
+    case 1: mode = MODE_1;       break;
+    case 2: mode = MODE_2;       break;
+    case 3: mode = MODE_1_2;     break;
+    case 4: mode = MODE_1_2_1;   break;
+    case 5: mode = MODE_1_2_2;   break;
+    case 6: mode = MODE_1_2_2_1; break;
+    default:
+      fprintf(stderr, "Unsupported WAV channels %u\n", numberOfChannels);
+      return false;
+    }
+    if (aacEncOpen(&m_handle, 0, numberOfChannels) != AACENC_OK) {
+      fprintf(stderr, "Unable to open encoder\n");
+      m_handle = NULL;
+      return false;
+    }
+    if (aacEncoder_SetParam(m_handle, AACENC_AOT, AAC_ENC_AOT) != AACENC_OK) {
+      fprintf(stderr, "Unable to set the AOT\n");
+      return failOpen();
+    }
+    if (AAC_ENC_AOT == 39 && AAC_ENC_ELD_SBR) {
+      if (aacEncoder_SetParam(m_handle, AACENC_SBR_MODE, 1) != AACENC_OK) {
+        fprintf(stderr, "Unable to set SBR mode for ELD\n");
+        return failOpen();
+      }
+    }
+    if (aacEncoder_SetParam(m_handle, AACENC_SAMPLERATE, samplingRate) != AACENC_OK) {
+      fprintf(stderr, "Unable to set the sampling rate\n");
+      return failOpen();
+    }
+    if (aacEncoder_SetParam(m_handle, AACENC_CHANNELMODE, mode) != AACENC_OK) {
+      fprintf(stderr, "Unable to set the channel mode\n");
+      return failOpen();
+    }
+    if (aacEncoder_SetParam(m_handle, AACENC_CHANNELORDER, 1) != AACENC_OK) {
+      fprintf(stderr, "Unable to set the wav channel order\n");
+      return failOpen();
+    }
+    if (AAC_ENC_VBR) {
+      if (aacEncoder_SetParam(m_handle, AACENC_BITRATEMODE, AAC_ENC_VBR) != AACENC_OK) {
+        fprintf(stderr, "Unable to set the VBR bitrate mode\n");
+        return failOpen();
+      }
+    } else {
+      if (aacEncoder_SetParam(m_handle, AACENC_BITRATE, AAC_ENC_BITRATE) != AACENC_OK) {
+        fprintf(stderr, "Unable to set the bitrate\n");
+        return failOpen();
+      }
+    }
+    if (aacEncoder_SetParam(m_handle, AACENC_TRANSMUX, 2) != AACENC_OK) {
+      fprintf(stderr, "Unable to set the ADTS transmux\n");
+      return failOpen();
+    }
+    if (aacEncoder_SetParam(m_handle, AACENC_AFTERBURNER, AAC_ENC_AFTERBURNER) != AACENC_OK) {
+      fprintf(stderr, "Unable to set the afterburner mode\n");
+      return failOpen();
+    }
+    if (aacEncEncode(m_handle, NULL, NULL, NULL, NULL) != AACENC_OK) {
+      fprintf(stderr, "Unable to initialize the encoder\n");
+      return failOpen();
+    }
+    if (aacEncInfo(m_handle, &info) != AACENC_OK) {
+      fprintf(stderr, "Unable to get the encoder info\n");
+      return failOpen();
+    }
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file) {
+      perror(path.c_str());
+      return failOpen();
+    }
+    m_numberOfChannels = numberOfChannels;
+    m_frameLength = info.frameLength;
+    m_bufferedFrames = 0;
+    m_convertBuffer.resize(m_frameLength * numberOfChannels);
+    m_channelPointers.resize(numberOfChannels);
+    return true;
+  }
+
+  bool appendFrames(const ConstAudioBufferView& view) {
+    if (m_handle == NULL) {
+      return false;
+    }
+    assert(view.getNumberOfChannels() >= m_numberOfChannels);
+    const size_t numFrames = view.getLength();
+    size_t running = 0;
+    while (running < numFrames) {
+      size_t count = std::min((size_t)(m_frameLength - m_bufferedFrames), numFrames - running);
+      int16_t* out = &m_convertBuffer[m_bufferedFrames * m_numberOfChannels];
+      for (unsigned int ch = 0; ch < m_numberOfChannels; ++ch) {
+        m_channelPointers[ch] = view[ch] + running;
+      }
+      conversion::interleave(&m_channelPointers[0], out, m_numberOfChannels, count);
+      m_bufferedFrames += count;
+      running += count;
+      if (m_bufferedFrames == m_frameLength) {
+        if (encode(m_bufferedFrames * m_numberOfChannels) != AACENC_OK) {
+          fprintf(stderr, "Encoding failed\n");
+          return false;
+        }
+        m_bufferedFrames = 0;
+      }
+    }
+    return true;
+  }
+
+  bool finalize() {
+    if (m_handle == NULL) {
+      return false;
+    }
+    bool success = true;
+    if (m_bufferedFrames > 0) {
+      success = encode(m_bufferedFrames * m_numberOfChannels) == AACENC_OK;
+      m_bufferedFrames = 0;
+    }
+    AACENC_ERROR err;
+    while ((err = encode(-1)) == AACENC_OK) {}
+    if (err != AACENC_ENCODE_EOF) {
+      fprintf(stderr, "Encoding failed\n");
+      success = false;
+    }
+    fclose(m_file);
+    m_file = NULL;
+    aacEncClose(&m_handle);
+    m_handle = NULL;
+    return success;
+  }
+private:
+  // releases the encoder when open fails halfway
+  bool failOpen() {
+    aacEncClose(&m_handle);
+    m_handle = NULL;
+    return false;
+  }
+
+  // passes numSamples interleaved samples to the encoder, -1 to flush it
+  AACENC_ERROR encode(int numSamples) {
+    AACENC_BufDesc in_buf = { 0 }, out_buf = { 0 };
+    AACENC_InArgs in_args = { 0 };
+    AACENC_OutArgs out_args = { 0 };
+    int in_identifier = IN_AUDIO_DATA;
+    int in_size, in_elem_size;
+    int out_identifier = OUT_BITSTREAM_DATA;
+    int out_size, out_elem_size;
+    void *in_ptr, *out_ptr;
+    if (numSamples < 0) {
+      in_args.numInSamples = -1;
+    } else {
+      in_ptr = &m_convertBuffer[0];
+      in_size = numSamples * 2;
+      in_elem_size = 2;
+      in_args.numInSamples = numSamples;
+      in_buf.numBufs = 1;
+      in_buf.bufs = &in_ptr;
+      in_buf.bufferIdentifiers = &in_identifier;
+      in_buf.bufSizes = &in_size;
+      in_buf.bufElSizes = &in_elem_size;
+    }
+    out_ptr = m_outBuffer;
+    out_size = sizeof(m_outBuffer);
+    out_elem_size = 1;
+    out_buf.numBufs = 1;
+    out_buf.bufs = &out_ptr;
+    out_buf.bufferIdentifiers = &out_identifier;
+    out_buf.bufSizes = &out_size;
+    out_buf.bufElSizes = &out_elem_size;
+    AACENC_ERROR err = aacEncEncode(m_handle, &in_buf, &out_buf, &in_args, &out_args);
+    if (err == AACENC_OK && out_args.numOutBytes > 0) {
+      fwrite(m_outBuffer, 1, out_args.numOutBytes, m_file);
+    }
+    return err;
+  }
+
+  FILE* m_file;
+  HANDLE_AACENCODER m_handle;
+  unsigned int m_numberOfChannels;
+  unsigned int m_frameLength;
+  unsigned int m_bufferedFrames;
+  std::vector<int16_t> m_convertBuffer;
+  std::vector<const float*> m_channelPointers;
+  uint8_t m_outBuffer[20480];
+};
+
+}
+
+  // pass a ptr to AudioFormat if you wanna know the format of the decoded file
+bool AudioFormat_aac::loadFile(const std::string& path_,
+  AudioBuffer& buffer_,
+  float& samplingRate_,
+  void** formatDetail_) {
+  AudioFormatReader_aac reader;
+  if (!reader.open(path_)) {
+    return false;
+  }
+  if (reader.getLength() == 0) {
+    std::cerr << "No audio frames in " << path_ << std::endl;
+    return false;
+  }
+  samplingRate_ = reader.getSamplingRate();
+  buffer_.resize(reader.getNumberOfChannels(), reader.getLength());
+  // every sample is about to be written, no need to clear them
+  buffer_.markAsWritten();
+  AudioBufferView view(buffer_.data, buffer_.channels, 0, buffer_.size);
+  size_t count = reader.readFrames(view);
+  if (count != buffer_.size) {
+    // a truncated stream, keep what could be decoded
+    std::cerr << "Only " << count << " of " << buffer_.size << " frames could be decoded from " << path_ << std::endl;
+    buffer_.usedSize = count;
+  }
+  return count > 0;
 }
 
 // the format specifies the type, not the extension!
@@ -202,189 +585,71 @@ bool AudioFormat_aac::writeFile(const std::string& path,
   const float samplingRate,
   const AudioFormatTypes format_,
   const void* formatDetail_) {
-  int bitrate = 64000;
-  const char* outfile;
-	FILE *out;
-	int input_size;
-	int16_t* convert_buf;
-	int aot = 2;
-	int afterburner = 1;
-	int eld_sbr = 0;
-	int vbr = 0;
-	HANDLE_AACENCODER handle;
-	CHANNEL_MODE mode;
-	AACENC_InfoStruct info = { 0 };
-//	while ((ch = getopt(argc, argv, "r:t:a:s:v:")) != -1) {
-//		switch (ch) {
-//		case 'r':
-//			bitrate = atoi(optarg);
-//			break;
-//		case 't':
-//			aot = atoi(optarg);
-//			break;
-//		case 'a':
-//			afterburner = atoi(optarg);
-//			break;
-//		case 's':
-//			eld_sbr = atoi(optarg);
-//			break;
-//		case 'v':
-//			vbr = atoi(optarg);
-//			break;
-//		case '?':
-//		default:
-//			usage(argv[0]);
-//			return 1;
-//		}
-//	}
-//	if (argc - optind < 2) {
-//		usage(argv[0]);
-//		return 1;
-//	}
-	outfile = path.c_str();
-
-	switch (buffer.channels) {
-	case 1: mode = MODE_1;       break;
-	case 2: mode = MODE_2;       break;
-	case 3: mode = MODE_1_2;     break;
-	case 4: mode = MODE_1_2_1;   break;
-	case 5: mode = MODE_1_2_2;   break;
-	case 6: mode = MODE_1_2_2_1; break;
-	default:
-		fprintf(stderr, "Unsupported WAV channels %zu\n", buffer.channels);
-		return 1;
-	}
-	if (aacEncOpen(&handle, 0, buffer.channels) != AACENC_OK) {
-		fprintf(stderr, "Unable to open encoder\n");
-		return 1;
-	}
-	if (aacEncoder_SetParam(handle, AACENC_AOT, aot) != AACENC_OK) {
-		fprintf(stderr, "Unable to set the AOT\n");
-		return 1;
-	}
-	if (aot == 39 && eld_sbr) {
-		if (aacEncoder_SetParam(handle, AACENC_SBR_MODE, 1) != AACENC_OK) {
-			fprintf(stderr, "Unable to set SBR mode for ELD\n");
-			return 1;
-		}
-	}
-	if (aacEncoder_SetParam(handle, AACENC_SAMPLERATE, samplingRate) != AACENC_OK) {
-		fprintf(stderr, "Unable to set the AOT\n");
-		return 1;
-	}
-	if (aacEncoder_SetParam(handle, AACENC_CHANNELMODE, mode) != AACENC_OK) {
-		fprintf(stderr, "Unable to set the channel mode\n");
-		return 1;
-	}
-	if (aacEncoder_SetParam(handle, AACENC_CHANNELORDER, 1) != AACENC_OK) {
-		fprintf(stderr, "Unable to set the wav channel order\n");
-		return 1;
-	}
-	if (vbr) {
-		if (aacEncoder_SetParam(handle, AACENC_BITRATEMODE, vbr) != AACENC_OK) {
-			fprintf(stderr, "Unable to set the VBR bitrate mode\n");
-			return 1;
-		}
-	} else {
-		if (aacEncoder_SetParam(handle, AACENC_BITRATE, bitrate) != AACENC_OK) {
-			fprintf(stderr, "Unable to set the bitrate\n");
-			return 1;
-		}
-	}
-	if (aacEncoder_SetParam(handle, AACENC_TRANSMUX, 2) != AACENC_OK) {
-		fprintf(stderr, "Unable to set the ADTS transmux\n");
-		return 1;
-	}
-	if (aacEncoder_SetParam(handle, AACENC_AFTERBURNER, afterburner) != AACENC_OK) {
-		fprintf(stderr, "Unable to set the afterburner mode\n");
-		return 1;
-	}
-	if (aacEncEncode(handle, NULL, NULL, NULL, NULL) != AACENC_OK) {
-		fprintf(stderr, "Unable to initialize the encoder\n");
-		return 1;
-	}
-	if (aacEncInfo(handle, &info) != AACENC_OK) {
-		fprintf(stderr, "Unable to get the encoder info\n");
-		return 1;
-	}
-
-	out = fopen(outfile, "wb");
-	if (!out) {
-		perror(outfile);
-		return 1;
-	}
-
-	input_size = buffer.channels*2*info.frameLength;
-	convert_buf = (int16_t*) malloc(input_size);
-  
-  int currentFrame = 0;
-  int stride = buffer.size + 1;
-  int16_t currentConvertedSample;
-  long currentSampleIndex = 0;
-  float * bufferStart = buffer.data[0];
-  int sizeMod = buffer.size * buffer.channels + 1;
-  uint8_t* sampleL;
-	while (1) {
-		AACENC_BufDesc in_buf = { 0 }, out_buf = { 0 };
-		AACENC_InArgs in_args = { 0 };
-		AACENC_OutArgs out_args = { 0 };
-		int in_identifier = IN_AUDIO_DATA;
-		int in_size, in_elem_size;
-		int out_identifier = OUT_BITSTREAM_DATA;
-		int out_size, out_elem_size;
-		void *in_ptr, *out_ptr;
-		uint8_t outbuf[20480];
-		AACENC_ERROR err;
-    int samplesToBeWritten = std::min((int)info.frameLength, (int)buffer.size - currentFrame - 1);
-    samplesToBeWritten *= buffer.channels;
-    int samplesThisFrame = 0;
-    while (samplesThisFrame < samplesToBeWritten) {
-      float fValue = *(bufferStart + currentSampleIndex);
-      currentConvertedSample = (int16_t)(fValue * 32767.F);
-      sampleL = (uint8_t*)&currentConvertedSample;
-      convert_buf[samplesThisFrame] = sampleL[0] | (sampleL[1] << 8);
-      currentSampleIndex = currentSampleIndex + stride;
-      currentSampleIndex = currentSampleIndex % sizeMod;
-      ++samplesThisFrame;
-    }
-    currentFrame  = currentFrame + (samplesThisFrame / buffer.channels);
-		if (samplesThisFrame <= 0) {
-			in_args.numInSamples = -1;
-		} else {
-			in_ptr = convert_buf;
-			in_size = samplesThisFrame * 2;
-			in_elem_size = 2;
-
-			in_args.numInSamples = samplesThisFrame;
-			in_buf.numBufs = 1;
-			in_buf.bufs = &in_ptr;
-			in_buf.bufferIdentifiers = &in_identifier;
-			in_buf.bufSizes = &in_size;
-			in_buf.bufElSizes = &in_elem_size;
-		}
-		out_ptr = outbuf;
-		out_size = sizeof(outbuf);
-		out_elem_size = 1;
-		out_buf.numBufs = 1;
-		out_buf.bufs = &out_ptr;
-		out_buf.bufferIdentifiers = &out_identifier;
-		out_buf.bufSizes = &out_size;
-		out_buf.bufElSizes = &out_elem_size;
-
-		if ((err = aacEncEncode(handle, &in_buf, &out_buf, &in_args, &out_args)) != AACENC_OK) {
-			if (err == AACENC_ENCODE_EOF)
-				break;
-			fprintf(stderr, "Encoding failed\n");
-			return false;
-		}
-		if (out_args.numOutBytes == 0)
-			continue;
-		fwrite(outbuf, 1, out_args.numOutBytes, out);
-	}
-	free(convert_buf);
-	fclose(out);
-	aacEncClose(&handle);
-	return true;
+  AudioFormatWriter_aac writer;
+  if (!writer.open(path, samplingRate, buffer.channels, format_, formatDetail_)) {
+    return false;
+  }
+  if (!writer.appendFrames(buffer.getConstView())) {
+    return false;
+  }
+  return writer.finalize();
+}
+
+// Everything comes from the ADTS headers, assuming 1024 samples per raw data
+// block like the reader does for AAC-LC. Streams with implicit SBR decode at
+// twice the sampling rate written in the header, which can't be known without
+// decoding.
+bool AudioFormat_aac::getFileInfo(const std::string& path,
+  float& samplingRate_,
+  unsigned int& numberOfChannels_,
+  unsigned int& bitsPerChannel_,
+  unsigned long& length_) {
+  static const unsigned int kSamplingRates[13] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+  };
+  FileInputStream file;
+  if (!file.open(path)) {
+    return false;
+  }
+  std::vector<AdtsFrame> frames;
+  unsigned long blocks = scanAdtsFrames(file, frames);
+  unsigned char header[7];
+  bool valid = !frames.empty() &&
+    file.seek(frames[0].offset) &&
+    file.read(header, 7) == 7;
+  file.close();
+  if (!valid) {
+    return false;
+  }
+  unsigned int samplingRateIndex = (header[2] >> 2) & 0x0F;
+  unsigned int channelConfiguration = ((header[2] & 0x01) << 2) | (header[3] >> 6);
+  if (samplingRateIndex >= 13) {
+    return false;
+  }
+  if (channelConfiguration == 0) {
+    // the channels are in a program config element, let the decoder find them
+    AudioFormatReader_aac reader;
+    if (!reader.open(path)) {
+      return false;
+    }
+    samplingRate_ = reader.getSamplingRate();
+    numberOfChannels_ = reader.getNumberOfChannels();
+    length_ = reader.getLength();
+  } else {
+    samplingRate_ = kSamplingRates[samplingRateIndex];
+    numberOfChannels_ = channelConfiguration == 7 ? 8 : channelConfiguration;
+    length_ = encodedLength(blocks, 1024);
+  }
+  bitsPerChannel_ = 0;
+  return true;
+}
+
+std::unique_ptr<AudioFormatReader> AudioFormat_aac::createReader() {
+  return std::unique_ptr<AudioFormatReader>(new AudioFormatReader_aac());
+}
+
+std::unique_ptr<AudioFormatWriter> AudioFormat_aac::createWriter() {
+  return std::unique_ptr<AudioFormatWriter>(new AudioFormatWriter_aac());
 }
 
 
@@ -31,15 +31,13 @@
 #define __AudioFormat_aac_
 
 #include "AudioFormat.hpp"
-#include <list>
 
-namespace dinahmoe {
+namespace asu {
 namespace assets {
 
 class AudioFormat_aac : public AudioFormat {
 public:
   AudioFormat_aac();
-  ~AudioFormat_aac();
 
   // pass a ptr to AudioFormat if you wanna know the format of the decoded file
   bool loadFile(const std::string& path,
@@ -53,18 +51,16 @@ public:
     const float samplingRate,
     const AudioFormatTypes format_,
     const void* formatDetail_ = nullptr);
-  
-  // this list contains the decoded buffers and it's reused
-  typedef struct DecodedBuffer_ {
-    DecodedBuffer_(signed short* ptr_,
-      signed int usedFrames_,
-      signed int allocatedSamples_) :
-      ptr(ptr_), usedFrames(usedFrames_), allocatedSamples(allocatedSamples_) {}
-    signed short* ptr;
-    signed int usedFrames;
-    signed int allocatedSamples;
-  } DecodedBuffer;
-  std::list<DecodedBuffer> m_buffers;
+
+  bool getFileInfo(const std::string& path,
+    float& samplingRate,
+    unsigned int& numberOfChannels_,
+    unsigned int& bitsPerChannel,
+    unsigned long& length_);
+
+  std::unique_ptr<AudioFormatReader> createReader();
+
+  std::unique_ptr<AudioFormatWriter> createWriter();
 };
 
 }
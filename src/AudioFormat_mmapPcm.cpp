@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software 
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#include "AudioFormat_mmapPcm.hpp"
+#include "MappedAudioFile.hpp"
+
+namespace asu {
+namespace assets {
+
+namespace {
+
+class AudioFormatReader_mmapPcm : public AudioFormatReader {
+public:
+  AudioFormatReader_mmapPcm(const RAWOptions& rawOptions_) :
+    m_rawOptions(rawOptions_),
+    m_position(0) {
+  }
+
+  bool open(const std::string& path) {
+    m_position = 0;
+    if (!m_file.open(path, m_rawOptions)) {
+      return false;
+    }
+    setInfo();
+    return true;
+  }
+
+  // the samples are converted from the memory of the stream, or from a copy
+  // if it has none. RAW streams are not supported, they have no header
+  bool openStream(std::shared_ptr<AudioInputStream> stream) {
+    close();
+    m_position = 0;
+    const void* data = getStreamData(*stream, m_memory);
+    if (data == nullptr || !m_file.open(data, (size_t)stream->getLength())) {
+      m_memory.clear();
+      return false;
+    }
+    m_stream = stream;
+    setInfo();
+    return true;
+  }
+
+  size_t readFrames(const AudioBufferView& view) {
+    if (!m_file.isOpen()) {
+      return 0;
+    }
+    assert(view.getNumberOfChannels() == m_numberOfChannels);
+    for (unsigned int ch = 0; ch < m_numberOfChannels; ++ch) {
+      m_channelPointers[ch] = view[ch];
+    }
+    size_t count = m_file.convertFrames(&m_channelPointers[0], m_position, view.getLength());
+    m_position += count;
+    return count;
+  }
+
+  bool seek(unsigned long frame) {
+    if (!m_file.isOpen() || frame > m_file.getLength()) {
+      return false;
+    }
+    m_position = frame;
+    return true;
+  }
+
+  void close() {
+    m_file.close();
+    m_stream.reset();
+    m_memory.clear();
+  }
+private:
+  void setInfo() {
+    m_samplingRate = m_file.getSamplingRate();
+    m_numberOfChannels = m_file.getNumberOfChannels();
+    m_length = m_file.getLength();
+    m_channelPointers.resize(m_numberOfChannels);
+  }
+
+  MappedAudioFile m_file;
+  std::shared_ptr<AudioInputStream> m_stream;
+  std::vector<unsigned char> m_memory;
+  RAWOptions m_rawOptions;
+  unsigned long m_position;
+  std::vector<float*> m_channelPointers;
+};
+
+}
+
+AudioFormat_mmapPcm::AudioFormat_mmapPcm() {
+  m_supportedFormatsForReading.push_back(ASU_FORMAT_WAV);
+  m_supportedFormatsForReading.push_back(ASU_FORMAT_AIFF);
+  m_supportedFormatsForReading.push_back(ASU_FORMAT_RAW);
+}
+
+bool AudioFormat_mmapPcm::loadFile(const std::string& path,
+  AudioBuffer& buffer,
+  float& samplingRate,
+  void** formatDetail_) {
+  MappedAudioFile file;
+  if (!file.open(path, getRawOptions())) {
+    return false;
+  }
+  samplingRate = file.getSamplingRate();
+  buffer.resize(file.getNumberOfChannels(), file.getLength());
+  file.readFrames(buffer, 0, file.getLength());
+  return true;
+}
+
+bool AudioFormat_mmapPcm::writeFile(const std::string& path,
+  AudioBuffer& buffer,
+  const float samplingRate,
+  const AudioFormatTypes format_,
+  const void* formatDetail_) {
+  return false;
+}
+
+bool AudioFormat_mmapPcm::getFileInfo(const std::string& path,
+  float& samplingRate_,
+  unsigned int& numberOfChannels_,
+  unsigned int& bitsPerChannel_,
+  unsigned long& length_) {
+  MappedAudioFile file;
+  if (!file.open(path, getRawOptions())) {
+    return false;
+  }
+  samplingRate_ = file.getSamplingRate();
+  numberOfChannels_ = file.getNumberOfChannels();
+  bitsPerChannel_ = file.getBitsPerSample();
+  length_ = file.getLength();
+  return true;
+}
+
+std::unique_ptr<AudioFormatReader> AudioFormat_mmapPcm::createReader() {
+  return std::unique_ptr<AudioFormatReader>(new AudioFormatReader_mmapPcm(getRawOptions()));
+}
+
+}
+}
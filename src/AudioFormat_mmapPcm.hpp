@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software 
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#ifndef __AudioFormat_mmapPcm_
+#define __AudioFormat_mmapPcm_
+
+#include <mutex>
+#include "AudioFormat.hpp"
+#include "AudioFormatOptions.hpp"
+
+namespace asu {
+namespace assets {
+
+// Reads uncompressed WAV, AIFF and RAW files through a memory mapping.
+// Compressed WAV/AIFC files are refused, so that the manager can fall back
+// on the next decoder registered for the format.
+class AudioFormat_mmapPcm : public AudioFormat {
+public:
+  AudioFormat_mmapPcm();
+
+  // pass a ptr to AudioFormat if you wanna know the format of the decoded file
+  bool loadFile(const std::string& path,
+    AudioBuffer& buffer,
+    float& samplingRate,
+    void** formatDetail_ = NULL);
+
+  // writing is left to the other backends
+  bool writeFile(const std::string& path,
+    AudioBuffer& buffer,
+    const float samplingRate,
+    const AudioFormatTypes format_,
+    const void* formatDetail_ = nullptr);
+
+  bool getFileInfo(const std::string& path,
+    float& samplingRate,
+    unsigned int& numberOfChannels_,
+    unsigned int& bitsPerChannel,
+    unsigned long& length_);
+
+  std::unique_ptr<AudioFormatReader> createReader();
+
+  // layout assumed for the RAW files, which have no header. It can change
+  // while other threads are decoding, they see either the old or the new one
+  void setRawOptions(const RAWOptions& options_) {
+    std::lock_guard<std::mutex> lock(m_rawOptionsMutex);
+    m_rawOptions = options_;
+  }
+  RAWOptions getRawOptions() const {
+    std::lock_guard<std::mutex> lock(m_rawOptionsMutex);
+    return m_rawOptions;
+  }
+
+private:
+  RAWOptions m_rawOptions;
+  mutable std::mutex m_rawOptionsMutex;
+};
+
+}
+}
+
+#endif /* defined(__AudioFormat_mmapPcm_) */
@@ -27,47 +27,132 @@
 
  
 #include "AudioFormat_ogg.hpp"
+#include <iostream>
+#include "SampleConversion.h"
 #include "stb_vorbis.c"
 
 namespace asu {
 namespace assets {
 
+namespace {
+
+class AudioFormatReader_ogg : public AudioFormatReader {
+public:
+  AudioFormatReader_ogg() : m_vorbis(NULL) {}
+  ~AudioFormatReader_ogg() { close(); }
+
+  bool open(const std::string& path) {
+    close();
+    int error = 0;
+    m_vorbis = stb_vorbis_open_filename(const_cast<char*>(path.c_str()), &error, NULL);
+    if (m_vorbis == NULL) {
+      std::cerr << "Not able to open input file " << path << std::endl;
+      return false;
+    }
+    setInfo();
+    return true;
+  }
+
+  // stb_vorbis wants the whole stream in memory, it is only copied if the
+  // stream doesn't have it already
+  bool openStream(std::shared_ptr<AudioInputStream> stream) {
+    close();
+    const void* data = getStreamData(*stream, m_memory);
+    if (data == nullptr) {
+      return false;
+    }
+    int error = 0;
+    m_vorbis = stb_vorbis_open_memory((unsigned char*)const_cast<void*>(data), (int)stream->getLength(), &error, NULL);
+    if (m_vorbis == NULL) {
+      m_memory.clear();
+      return false;
+    }
+    m_stream = stream;
+    setInfo();
+    return true;
+  }
+
+  size_t readFrames(const AudioBufferView& view) {
+    if (m_vorbis == NULL) {
+      return 0;
+    }
+    assert(view.getNumberOfChannels() == m_numberOfChannels);
+    const size_t numFrames = view.getLength();
+    size_t running = 0;
+    while (running < numFrames) {
+      for (unsigned int ch = 0; ch < m_numberOfChannels; ++ch) {
+        m_channelPointers[ch] = view[ch] + running;
+      }
+      int count = stb_vorbis_get_samples_float(m_vorbis,
+        m_numberOfChannels,
+        &m_channelPointers[0],
+        (int)(numFrames - running));
+      if (count <= 0) {
+        break;
+      }
+      running += count;
+    }
+    return running;
+  }
+
+  bool seek(unsigned long frame) {
+    return m_vorbis != NULL && stb_vorbis_seek(m_vorbis, frame) != 0;
+  }
+
+  void close() {
+    if (m_vorbis != NULL) {
+      stb_vorbis_close(m_vorbis);
+      m_vorbis = NULL;
+    }
+    m_stream.reset();
+    m_memory.clear();
+  }
+private:
+  void setInfo() {
+    stb_vorbis_info info = stb_vorbis_get_info(m_vorbis);
+    m_samplingRate = info.sample_rate;
+    m_numberOfChannels = info.channels;
+    m_length = stb_vorbis_stream_length_in_samples(m_vorbis);
+    m_channelPointers.resize(info.channels);
+  }
+
+  stb_vorbis* m_vorbis;
+  std::shared_ptr<AudioInputStream> m_stream;
+  std::vector<unsigned char> m_memory;
+  std::vector<float*> m_channelPointers;
+};
+
+}
+
 AudioFormat_ogg::AudioFormat_ogg() {
   m_supportedFormatsForReading.push_back(ASU_FORMAT_OGG);
 }
 
+// decodes straight into the planar float buffer, a chunk at a time
 bool AudioFormat_ogg::loadFile(const std::string& path,
   AudioBuffer& outBuf,
   float& samplingRate,
   void** formatDetail_) {
-    try {
-    short *decoded;
-    int channels, len;
-    len = stb_vorbis_decode_filename(const_cast<char*>(path.c_str()), &channels, &decoded);
-    if (len <= 0) {
-      return false;
-    }
-    outBuf.resize(channels, len);
-    // deinterleave
-    int frameIndex = 0;
-    short* audioDataIn = NULL;
-    float* audioDataOut = NULL;
-    for (int chan = 0; chan < channels; ++chan) {
-      audioDataIn = decoded + chan;
-      audioDataOut = outBuf.data[chan];
-      frameIndex = 0;
-      while (frameIndex++ < len) {
-        *audioDataOut = (float)*audioDataIn / 32767.F;
-        audioDataIn += channels;
-        ++audioDataOut;
-      }
-    }
-    outBuf.isSilent = false;
-    samplingRate = 44100; // todo: the stb_vorbis_decode_filename is the only one that doesnt show the samplingrate :/
-    return true;
-  } catch (...) {
+  AudioFormatReader_ogg reader;
+  if (!reader.open(path)) {
+    return false;
+  }
+  if (reader.getLength() == 0) {
+    std::cerr << "Not able to find the length of " << path << std::endl;
     return false;
   }
+  samplingRate = reader.getSamplingRate();
+  outBuf.resize(reader.getNumberOfChannels(), reader.getLength());
+  // every sample is about to be written, no need to clear them
+  outBuf.markAsWritten();
+  AudioBufferView view(outBuf.data, outBuf.channels, 0, outBuf.size);
+  size_t count = reader.readFrames(view);
+  if (count != outBuf.size) {
+    // a truncated stream, keep what could be decoded
+    std::cerr << "Only " << count << " of " << outBuf.size << " frames could be decoded from " << path << std::endl;
+    outBuf.usedSize = count;
+  }
+  return count > 0;
 }
 
 bool AudioFormat_ogg::writeFile(const std::string& path,
@@ -78,5 +163,30 @@ bool AudioFormat_ogg::writeFile(const std::string& path,
   return false;
 }
 
+// stb_vorbis only parses the headers when opening, and finds the length in
+// the granule position of the last page
+bool AudioFormat_ogg::getFileInfo(const std::string& path,
+  float& samplingRate_,
+  unsigned int& numberOfChannels_,
+  unsigned int& bitsPerChannel_,
+  unsigned long& length_) {
+  int error = 0;
+  stb_vorbis* vorbis = stb_vorbis_open_filename(const_cast<char*>(path.c_str()), &error, NULL);
+  if (vorbis == NULL) {
+    return false;
+  }
+  stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+  samplingRate_ = info.sample_rate;
+  numberOfChannels_ = info.channels;
+  bitsPerChannel_ = 0;
+  length_ = stb_vorbis_stream_length_in_samples(vorbis);
+  stb_vorbis_close(vorbis);
+  return true;
+}
+
+std::unique_ptr<AudioFormatReader> AudioFormat_ogg::createReader() {
+  return std::unique_ptr<AudioFormatReader>(new AudioFormatReader_ogg());
+}
+
 }
 }
@@ -52,6 +52,13 @@ public:
     const AudioFormatTypes format_,
     const void* formatDetail_ = nullptr);
 
+  bool getFileInfo(const std::string& path,
+    float& samplingRate,
+    unsigned int& numberOfChannels_,
+    unsigned int& bitsPerChannel,
+    unsigned long& length_);
+
+  std::unique_ptr<AudioFormatReader> createReader();
 };
 
 }
@@ -1,16 +1,20 @@
 
 #include "AudioFormat_sndfile.hpp"
 #include <iostream>
+#include <algorithm>
+#include <mutex>
+#include "AudioFormatOptions.hpp"
+#include "SampleConversion.h"
 #include "sndfile.h"
 
-static bool sndfileCopyrightWritten = false;
+static std::once_flag sndfileCopyrightWritten;
 void LibsndfileCopyright()
 {
-  if (sndfileCopyrightWritten) return;
-  char vSndfileversion [256];
-  sf_command (NULL, SFC_GET_LIB_VERSION, vSndfileversion, sizeof (vSndfileversion));
-  std::cout << std::endl << "Using snd file IO: " << vSndfileversion << ", Copyright Erik de Castro Lopo, \nlicensed under the Gnu LGPL (see: http://www.mega-nerd.com/libsndfile or libsndfile.License)" << std::endl << std::endl;
-  sndfileCopyrightWritten = true;
+  std::call_once(sndfileCopyrightWritten, []() {
+    char vSndfileversion [256];
+    sf_command (NULL, SFC_GET_LIB_VERSION, vSndfileversion, sizeof (vSndfileversion));
+    std::cout << std::endl << "Using snd file IO: " << vSndfileversion << ", Copyright Erik de Castro Lopo, \nlicensed under the Gnu LGPL (see: http://www.mega-nerd.com/libsndfile or libsndfile.License)" << std::endl << std::endl;
+  });
 }
 
 
@@ -27,67 +31,280 @@ AudioFormat_sndfile::AudioFormat_sndfile() {
 
 #define BUFFER_SIZE 512
 
-  // pass a ptr to AudioFormat if you wanna know the format of the decoded file
-bool AudioFormat_sndfile::loadFile(const std::string& path,
-  AudioBuffer& buffer,
-  float& samplingRate,
-  void** formatDetail_) {
-  
-  SNDFILE* infile;
-  SF_INFO info;
-  
-  if (!(infile = sf_open(path.c_str(), SFM_READ, &info))) {
-    std::cerr << "Not able to open input file " << path << std::endl;
-		return false;
-	} 
-//  
-//  if (formatOut_ != NULL) {
-//    if ((info.format % SF_FORMAT_WAV) == SF_FORMAT_WAV) {
-//      *formatOut_ = DM_FORMAT_WAV;
-//    } else if ((info.format & SF_FORMAT_AIFF) == SF_FORMAT_AIFF) {
-//      *formatOut_ = DM_FORMAT_AIFF;
-//    } else {
-//      assert(false);
-//    }
-//  } 
-  
-  samplingRate = info.samplerate;
-	unsigned int v_readcount = 0;
-  buffer.resize(info.channels, info.frames);
-  
-  if (info.channels == 1) {
-    size_t count = 0;
+namespace {
+
+// libsndfile virtual IO on top of an AudioInputStream
+sf_count_t streamGetLength(void* userData) {
+  return ((AudioInputStream*)userData)->getLength();
+}
+
+sf_count_t streamSeek(sf_count_t offset, int whence, void* userData) {
+  AudioInputStream* stream = (AudioInputStream*)userData;
+  sf_count_t position = offset;
+  if (whence == SEEK_CUR) {
+    position += stream->tell();
+  } else if (whence == SEEK_END) {
+    position += stream->getLength();
+  }
+  if (position < 0 || !stream->seek(position)) {
+    return -1;
+  }
+  return position;
+}
+
+sf_count_t streamRead(void* destination, sf_count_t count, void* userData) {
+  return ((AudioInputStream*)userData)->read(destination, count);
+}
+
+sf_count_t streamWrite(const void* source, sf_count_t count, void* userData) {
+  return 0;
+}
+
+sf_count_t streamTell(void* userData) {
+  return ((AudioInputStream*)userData)->tell();
+}
+
+class AudioFormatReader_sndfile : public AudioFormatReader {
+public:
+  AudioFormatReader_sndfile() : m_file(NULL) {}
+  ~AudioFormatReader_sndfile() { close(); }
+
+  bool open(const std::string& path) {
+    close();
+    SF_INFO info;
+    info.format = 0;
+    if (!(m_file = sf_open(path.c_str(), SFM_READ, &info))) {
+      std::cerr << "Not able to open input file " << path << std::endl;
+      return false;
+    }
+    setInfo(info);
+    return true;
+  }
+
+  bool openStream(std::shared_ptr<AudioInputStream> stream) {
+    close();
+    SF_VIRTUAL_IO io;
+    io.get_filelen = streamGetLength;
+    io.seek = streamSeek;
+    io.read = streamRead;
+    io.write = streamWrite;
+    io.tell = streamTell;
+    SF_INFO info;
+    info.format = 0;
+    if (!stream->seek(0) || !(m_file = sf_open_virtual(&io, SFM_READ, &info, stream.get()))) {
+      return false;
+    }
+    m_stream = stream;
+    setInfo(info);
+    return true;
+  }
+
+  size_t readFrames(const AudioBufferView& view) {
+    if (m_file == NULL) {
+      return 0;
+    }
+    assert(view.getNumberOfChannels() == m_numberOfChannels);
+    const size_t numFrames = view.getLength();
     size_t running = 0;
-    do {
-      count = std::min((size_t)BUFFER_SIZE, (size_t)info.frames - running);
-      if((v_readcount = sf_read_float(infile, buffer.data[0] + running, count)) != count) {
-        std::cerr << "Error reading the input file!" << std::endl;
+    while (running < numFrames) {
+      sf_count_t count = std::min((size_t)BUFFER_SIZE, numFrames - running);
+      if (m_numberOfChannels == 1) {
+        count = sf_readf_float(m_file, view[0] + running, count);
+      } else {
+        count = sf_readf_float(m_file, &m_interleaved[0], count);
+        if (count > 0) {
+          for (unsigned int ch = 0; ch < m_numberOfChannels; ++ch) {
+            m_channelPointers[ch] = view[ch] + running;
+          }
+          conversion::deinterleave(&m_interleaved[0], &m_channelPointers[0], m_numberOfChannels, count);
+        }
+      }
+      if (count <= 0) {
+        break;
+      }
+      running += count;
+    }
+    return running;
+  }
+
+  bool seek(unsigned long frame) {
+    return m_file != NULL && sf_seek(m_file, frame, SEEK_SET) != -1;
+  }
+
+  void close() {
+    if (m_file != NULL) {
+      sf_close(m_file);
+      m_file = NULL;
+    }
+    m_stream.reset();
+  }
+private:
+  void setInfo(const SF_INFO& info) {
+    m_samplingRate = info.samplerate;
+    m_numberOfChannels = info.channels;
+    m_length = info.frames;
+    m_interleaved.resize(BUFFER_SIZE * info.channels);
+    m_channelPointers.resize(info.channels);
+  }
+
+  SNDFILE* m_file;
+  // kept alive while libsndfile reads from it
+  std::shared_ptr<AudioInputStream> m_stream;
+  std::vector<float> m_interleaved;
+  std::vector<float*> m_channelPointers;
+};
+
+// The samples are converted by SampleConversion a block at a time and handed
+// to libsndfile already in the type of the file, so that the rounding and
+// the dither are the same for every backend.
+class AudioFormatWriter_sndfile : public AudioFormatWriter {
+public:
+  AudioFormatWriter_sndfile() : m_file(NULL), m_numberOfChannels(0) {}
+  ~AudioFormatWriter_sndfile() { finalize(); }
+
+  bool open(const std::string& path,
+    const float samplingRate,
+    const unsigned int numberOfChannels,
+    const AudioFormatTypes format_,
+    const void* formatDetail_) {
+    finalize();
+    SF_INFO info;
+    info.sections = 1;
+    info.seekable = 1;
+    info.samplerate = samplingRate;
+    info.channels = numberOfChannels;
+    info.frames = 0;
+    info.format = 0;
+    m_options = PCMWriteOptions();
+    if (format_ == ASU_FORMAT_WAV) {
+      info.format = SF_FORMAT_WAV;
+      if (formatDetail_ != nullptr) {
+        m_options = *static_cast<const WAVOptions*>(formatDetail_);
+      }
+    } else if (format_ == ASU_FORMAT_AIFF) {
+      info.format = SF_FORMAT_AIFF;
+      if (formatDetail_ != nullptr) {
+        m_options = *static_cast<const AIFFOptions*>(formatDetail_);
+      }
+    }
+    if (m_options.isFloat && m_options.bitsPerSample == 32) {
+      info.format = info.format | SF_FORMAT_FLOAT;
+    } else if (!m_options.isFloat && m_options.bitsPerSample == 16) {
+      info.format = info.format | SF_FORMAT_PCM_16;
+    } else if (!m_options.isFloat && m_options.bitsPerSample == 24) {
+      info.format = info.format | SF_FORMAT_PCM_24;
+    } else if (!m_options.isFloat && m_options.bitsPerSample == 32) {
+      info.format = info.format | SF_FORMAT_PCM_32;
+    } else {
+      std::cerr << "Unsupported sample format: " << m_options.bitsPerSample << (m_options.isFloat ? " bits float" : " bits") << std::endl;
+      return false;
+    }
+    if (!(m_file = sf_open(path.c_str(), SFM_WRITE, &info))) {
+      std::cerr << "Unable to open the output file " << path << std::endl;
+      std::cerr << sf_strerror(m_file);
+      return false;
+    }
+    m_numberOfChannels = numberOfChannels;
+    m_options.blockSize = std::max((size_t)1, m_options.blockSize);
+    m_dither = conversion::TpdfDither();
+    m_interleaved.clear();
+    m_shorts.clear();
+    m_ints.clear();
+    if (m_options.isFloat) {
+      m_interleaved.resize(m_options.blockSize * numberOfChannels);
+    } else if (m_options.bitsPerSample == 16) {
+      m_shorts.resize(m_options.blockSize * numberOfChannels);
+    } else {
+      m_ints.resize(m_options.blockSize * numberOfChannels);
+    }
+    m_channelPointers.resize(numberOfChannels);
+    return true;
+  }
+
+  bool appendFrames(const ConstAudioBufferView& view) {
+    if (m_file == NULL) {
+      return false;
+    }
+    assert(view.getNumberOfChannels() >= m_numberOfChannels);
+    const size_t numFrames = view.getLength();
+    if (m_numberOfChannels == 1 && m_options.isFloat) {
+      // nothing to convert
+      if (sf_writef_float(m_file, view[0], numFrames) != (sf_count_t)numFrames) {
+        std::cerr << "Error writing the output file!" << std::endl;
         return false;
       }
-      running += v_readcount;
-    } while (running < info.frames);
-  } else {
-    size_t count = 0;
+      return true;
+    }
+    conversion::TpdfDither* dither = m_options.dither ? &m_dither : nullptr;
     size_t running = 0;
-    float buf[BUFFER_SIZE * 2];
-    do {
-      count = std::min((size_t)BUFFER_SIZE, (size_t)info.frames - running) * 2;
-      if((v_readcount = sf_read_float(infile, buf, count)) != count) {
-        std::cerr << "Error reading the input file!" << std::endl;
-        return false;
+    while (running < numFrames) {
+      size_t count = std::min(m_options.blockSize, numFrames - running);
+      for (unsigned int ch = 0; ch < m_numberOfChannels; ++ch) {
+        m_channelPointers[ch] = view[ch] + running;
       }
-      int i = 0;
-      while(i < v_readcount) {
-        *(buffer.data[0] + running) = buf[i++];
-        *(buffer.data[1] + running) = buf[i++];
-        ++running;
+      sf_count_t written = 0;
+      if (m_options.isFloat) {
+        conversion::interleave(&m_channelPointers[0], &m_interleaved[0], m_numberOfChannels, count);
+        written = sf_writef_float(m_file, &m_interleaved[0], count);
+      } else if (m_options.bitsPerSample == 16) {
+        conversion::interleave(&m_channelPointers[0], &m_shorts[0], m_numberOfChannels, count, dither);
+        written = sf_writef_short(m_file, (const short*)&m_shorts[0], count);
+      } else {
+        if (m_options.bitsPerSample == 24) {
+          conversion::interleaveInt24(&m_channelPointers[0], &m_ints[0], m_numberOfChannels, count, dither);
+        } else {
+          conversion::interleave(&m_channelPointers[0], &m_ints[0], m_numberOfChannels, count);
+        }
+        written = sf_writef_int(m_file, (const int*)&m_ints[0], count);
       }
-    } while (running < info.frames);
+      if (written != (sf_count_t)count) {
+        std::cerr << "Error writing the output file!" << std::endl;
+        return false;
+      }
+      running += count;
+    }
+    return true;
+  }
+
+  bool finalize() {
+    if (m_file == NULL) {
+      return false;
+    }
+    bool success = sf_close(m_file) == 0;
+    m_file = NULL;
+    return success;
+  }
+private:
+  SNDFILE* m_file;
+  unsigned int m_numberOfChannels;
+  PCMWriteOptions m_options;
+  conversion::TpdfDither m_dither;
+  std::vector<float> m_interleaved;
+  std::vector<int16_t> m_shorts;
+  std::vector<int32_t> m_ints;
+  std::vector<const float*> m_channelPointers;
+};
+
+}
+
+  // pass a ptr to AudioFormat if you wanna know the format of the decoded file
+bool AudioFormat_sndfile::loadFile(const std::string& path,
+  AudioBuffer& buffer,
+  float& samplingRate,
+  void** formatDetail_) {
+  AudioFormatReader_sndfile reader;
+  if (!reader.open(path)) {
+    return false;
+  }
+  samplingRate = reader.getSamplingRate();
+  buffer.resize(reader.getNumberOfChannels(), reader.getLength());
+  // every sample is about to be written, no need to clear them
+  buffer.markAsWritten();
+  AudioBufferView view(buffer.data, buffer.channels, 0, buffer.size);
+  if (reader.readFrames(view) != buffer.size) {
+    std::cerr << "Error reading the input file!" << std::endl;
+    return false;
   }
-  
-  buffer.isSilent = false;
-  
-  sf_close(infile);
   return true;
 }
 
@@ -96,55 +313,65 @@ bool AudioFormat_sndfile::writeFile(const std::string& path,
   AudioBuffer& buffer,
   const float samplingRate,
   const AudioFormatTypes format_,
-  const void* formatDetail_) {  
-  SNDFILE* outfile;
+  const void* formatDetail_) {
+  AudioFormatWriter_sndfile writer;
+  if (!writer.open(path, samplingRate, buffer.usedChannels, format_, formatDetail_)) {
+    return false;
+  }
+  if (!writer.appendFrames(buffer.getConstView())) {
+    return false;
+  }
+  return writer.finalize();
+}
+
+bool AudioFormat_sndfile::getFileInfo(const std::string& path,
+  float& samplingRate_,
+  unsigned int& numberOfChannels_,
+  unsigned int& bitsPerChannel_,
+  unsigned long& length_) {
   SF_INFO info;
-  info.sections = 1;
-  info.seekable = 1;
-  info.samplerate = samplingRate;
-  info.channels = buffer.channels;
-  info.frames = buffer.size;
   info.format = 0;
-  if (format_ == ASU_FORMAT_WAV) {
-    info.format = SF_FORMAT_WAV;
-  } else if (format_ == ASU_FORMAT_AIFF) {
-    info.format = SF_FORMAT_AIFF;
-  }
-  info.format = info.format | SF_FORMAT_PCM_16;
-  
-  if (!(outfile = sf_open(path.c_str(), SFM_WRITE, &info))) {
-    std::cerr << "Unable to open the output file " << path << std::endl;
-    std::cerr << sf_strerror(outfile);
-		return false;
-	} 
-  
-	unsigned int v_writecount = 0;
-  
-  if (info.channels == 1) {
-    if((v_writecount = sf_write_float(outfile, buffer.getChannelData(0), buffer.usedSize)) != buffer.usedSize) {
-      std::cerr << "Error writing the output file!" << std::endl;
-      return false; 
-    }
-  } else {
-    size_t count = 0;
-    size_t running = 0;
-    float buf[BUFFER_SIZE * 2];
-    while(running < buffer.size) {
-      count = std::min((size_t)BUFFER_SIZE, (size_t)buffer.size - running);
-      for (int i = 0,  ii = 0; i < count; ++i, ++running) {
-        buf[ii++] = *(buffer.data[0] + running);
-        buf[ii++] = *(buffer.data[1] + running);
-      }
-      if((v_writecount = sf_write_float(outfile, buf, count * 2)) != count * 2) {
-        std::cerr << "Error writing the output file!" << std::endl;
-        exit(1);  
-      }
-    }
+  SNDFILE* file = sf_open(path.c_str(), SFM_READ, &info);
+  if (file == NULL) {
+    return false;
+  }
+  sf_close(file);
+  samplingRate_ = info.samplerate;
+  numberOfChannels_ = info.channels;
+  length_ = info.frames;
+  switch (info.format & SF_FORMAT_SUBMASK) {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_U8:
+      bitsPerChannel_ = 8;
+      break;
+    case SF_FORMAT_PCM_16:
+      bitsPerChannel_ = 16;
+      break;
+    case SF_FORMAT_PCM_24:
+      bitsPerChannel_ = 24;
+      break;
+    case SF_FORMAT_PCM_32:
+    case SF_FORMAT_FLOAT:
+      bitsPerChannel_ = 32;
+      break;
+    case SF_FORMAT_DOUBLE:
+      bitsPerChannel_ = 64;
+      break;
+    default:
+      bitsPerChannel_ = 0;
+      break;
   }
-  sf_close(outfile);
   return true;
 }
 
+std::unique_ptr<AudioFormatReader> AudioFormat_sndfile::createReader() {
+  return std::unique_ptr<AudioFormatReader>(new AudioFormatReader_sndfile());
+}
+
+std::unique_ptr<AudioFormatWriter> AudioFormat_sndfile::createWriter() {
+  return std::unique_ptr<AudioFormatWriter>(new AudioFormatWriter_sndfile());
+}
+
 
 }
 }
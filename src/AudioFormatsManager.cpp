@@ -31,6 +31,10 @@
 #include "StringUtilities.h"
 
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "AudioFormat.hpp"
 
 #ifdef ASUTILITIES_USE_COREAUDIO
@@ -49,10 +53,54 @@
 #include "AudioFormat_sndfile.hpp"
 #endif
 
+#ifdef ASUTILITIES_USE_MMAPPCM
+#include "AudioFormat_mmapPcm.hpp"
+#endif
+
 namespace asu {
 namespace assets {
+
+namespace {
+
+// nanoseconds, files rewritten within the same second still look modified.
+// Windows only has seconds, the size still tells most rewrites apart
+long long modificationTime(const struct stat& st_) {
+  #if defined(_WIN32)
+  return (long long)st_.st_mtime * 1000000000LL;
+  #elif defined(__APPLE__)
+  return (long long)st_.st_mtimespec.tv_sec * 1000000000LL + st_.st_mtimespec.tv_nsec;
+  #else
+  return (long long)st_.st_mtim.tv_sec * 1000000000LL + st_.st_mtim.tv_nsec;
+  #endif
+}
+
+// the format from the first bytes, and those after a big ID3 tag. The hint
+// from the extension wins over a bare frame sync. The stream is rewound
+AudioFormatTypes probeStream(AudioInputStream& stream_, AudioFormatTypes hint_) {
+  const size_t kHeaderSize = 512;
+  unsigned char header[kHeaderSize];
+  stream_.seek(0);
+  size_t count = stream_.read(header, kHeaderSize);
+  AudioFormatTypes format = probeAudioFormat(header, count, hint_);
+  size_t tagSize = id3TagSize(header, count);
+  if (tagSize + 4 > count && tagSize < stream_.getLength() && stream_.seek(tagSize)) {
+    AudioFormatTypes afterTag = probeAudioFormat(header, stream_.read(header, kHeaderSize));
+    if (afterTag != ASU_FORMAT_UNKNOWN) {
+      format = afterTag;
+    }
+  }
+  stream_.seek(0);
+  return format;
+}
+
+}
  
 AudioFormatsManager::AudioFormatsManager() {
+  // first, so that uncompressed files skip the other decoders
+  #ifdef ASUTILITIES_USE_MMAPPCM
+  addFormat(std::shared_ptr<AudioFormat>(new AudioFormat_mmapPcm()));
+  #endif
+
   #if defined(ASUTILITIES_USE_COREAUDIO)
   addFormat(std::shared_ptr<AudioFormat>(new AudioFormat_CoreAudio()));
   #endif
@@ -73,11 +121,7 @@ AudioFormatsManager::AudioFormatsManager() {
 
 void AudioFormatsManager::addFormat(std::shared_ptr<AudioFormat> fmt_) {
   for (auto format: fmt_->getSupportedFormatsForReading()) {
-    if (m_formatsForReading.find(format) != m_formatsForReading.end()) {
-      std::cerr << "The format " << formatToStr(format) << " has already been added to the AudioFormatManager (reading)" << std::endl;
-      continue;
-    }
-    m_formatsForReading.insert(std::make_pair(format, fmt_));
+    m_formatsForReading[format].push_back(fmt_);
   }
   for (auto format: fmt_->getSupportedFormatsForWriting()) {
     if (m_formatsForWriting.find(format) != m_formatsForWriting.end()) {
@@ -92,13 +136,33 @@ bool AudioFormatsManager::loadFile(const std::string& path_,
     AudioBuffer& buffer_,
     float& samplingRate_,
     void** formatDetail_) {
-  std::string extension = utilities::getFileExtension(path_);
-  auto formatForFile = m_formatsForReading.find(extensionToAudioFormat(extension.c_str()));
-  if (formatForFile == m_formatsForReading.end()) {
-    std::cerr << "No decoder for file " << path_ << std::endl;
+  const DecoderList* decoders = decodersForFile(path_);
+  if (decoders == nullptr) {
     return false;
   }
-  return formatForFile->second->loadFile(path_, buffer_, samplingRate_);
+  for (auto& decoder: *decoders) {
+    if (decoder->loadFile(path_, buffer_, samplingRate_)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AudioFormatsManager::loadRange(const std::string& path_,
+    unsigned long startFrame_,
+    size_t numFrames_,
+    AudioBuffer& buffer_,
+    float& samplingRate_) {
+  const DecoderList* decoders = decodersForFile(path_);
+  if (decoders == nullptr) {
+    return false;
+  }
+  for (auto& decoder: *decoders) {
+    if (decoder->loadRange(path_, startFrame_, numFrames_, buffer_, samplingRate_)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool AudioFormatsManager::writeFile(const std::string& path_,
@@ -112,7 +176,7 @@ bool AudioFormatsManager::writeFile(const std::string& path_,
     std::cerr << "No encoder for type " << formatToStr(format_) << std::endl;
     return false;
   }
-  return formatForFile->second->writeFile(path_, buffer_, samplingRate_, format_);
+  return formatForFile->second->writeFile(path_, buffer_, samplingRate_, format_, formatDetail_);
 }
 
 bool AudioFormatsManager::getFileInfo(const std::string& path_,
@@ -121,15 +185,213 @@ bool AudioFormatsManager::getFileInfo(const std::string& path_,
   unsigned int& numberOfChannels_,
   unsigned int& bitsPerChannel_,
   unsigned long& length_) {
-  
-  std::string extension = utilities::getFileExtension(path_);
-  auto formatForFile = m_formatsForReading.find(extensionToAudioFormat(extension.c_str()));
+  const DecoderList* decoders = decodersForFile(path_);
+  if (decoders == nullptr) {
+    return false;
+  }
+  format_ = probeFile(path_);
+  for (auto& decoder: *decoders) {
+    if (decoder->getFileInfo(path_, samplingRate_, numberOfChannels_, bitsPerChannel_, length_)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AudioFormatsManager::loadStream(std::shared_ptr<AudioInputStream> stream_,
+    AudioBuffer& buffer_,
+    float& samplingRate_,
+    const AudioFormatTypes format_) {
+  const DecoderList* decoders = decodersForStream(*stream_, format_);
+  if (decoders == nullptr) {
+    return false;
+  }
+  for (auto& decoder: *decoders) {
+    if (decoder->loadStream(stream_, buffer_, samplingRate_)) {
+      return true;
+    }
+  }
+  std::cerr << "No decoder could read the stream" << std::endl;
+  return false;
+}
+
+bool AudioFormatsManager::loadMemory(const void* data_,
+    size_t size_,
+    AudioBuffer& buffer_,
+    float& samplingRate_,
+    const AudioFormatTypes format_) {
+  return loadStream(std::make_shared<MemoryInputStream>(data_, size_), buffer_, samplingRate_, format_);
+}
+
+std::unique_ptr<AudioFormatReader> AudioFormatsManager::openStream(std::shared_ptr<AudioInputStream> stream_,
+    const AudioFormatTypes format_) {
+  const DecoderList* decoders = decodersForStream(*stream_, format_);
+  if (decoders == nullptr) {
+    return nullptr;
+  }
+  for (auto& decoder: *decoders) {
+    std::unique_ptr<AudioFormatReader> reader = decoder->createReader();
+    if (reader && reader->openStream(stream_)) {
+      return reader;
+    }
+  }
+  std::cerr << "No decoder could open the stream for reading in chunks" << std::endl;
+  return nullptr;
+}
+
+std::vector<AudioFileInfo> AudioFormatsManager::getFileInfo(const std::vector<std::string>& paths_,
+    unsigned int numberOfThreads_) {
+  std::vector<AudioFileInfo> infos(paths_.size());
+  if (numberOfThreads_ == 0) {
+    numberOfThreads_ = std::max(1U, std::thread::hardware_concurrency());
+  }
+  numberOfThreads_ = std::min(numberOfThreads_, (unsigned int)paths_.size());
+  // the files are handed out one at a time, their headers take very different times to parse
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t index;
+    while ((index = next++) < paths_.size()) {
+      AudioFileInfo& info = infos[index];
+      info.path = paths_[index];
+      info.valid = getFileInfo(info.path, info.format, info.samplingRate,
+        info.numberOfChannels, info.bitsPerChannel, info.length);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < numberOfThreads_; ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  return infos;
+}
+
+std::unique_ptr<AudioFormatReader> AudioFormatsManager::openFile(const std::string& path_) {
+  const DecoderList* decoders = decodersForFile(path_);
+  if (decoders == nullptr) {
+    return nullptr;
+  }
+  for (auto& decoder: *decoders) {
+    std::unique_ptr<AudioFormatReader> reader = decoder->createReader();
+    if (reader && reader->open(path_)) {
+      return reader;
+    }
+  }
+  std::cerr << "No decoder could open " << path_ << " for reading in chunks" << std::endl;
+  return nullptr;
+}
+
+std::unique_ptr<AudioFormatWriter> AudioFormatsManager::createFile(const std::string& path_,
+    const float samplingRate_,
+    const unsigned int numberOfChannels_,
+    const AudioFormatTypes format_,
+    const void* formatDetail_) {
+  auto formatForFile = m_formatsForWriting.find(format_);
+  if (formatForFile == m_formatsForWriting.end()) {
+    std::cerr << "No encoder for type " << formatToStr(format_) << std::endl;
+    return nullptr;
+  }
+  std::unique_ptr<AudioFormatWriter> writer = formatForFile->second->createWriter();
+  if (!writer) {
+    std::cerr << "The encoder for " << formatToStr(format_) << " can't write in chunks" << std::endl;
+    return nullptr;
+  }
+  if (!writer->open(path_, samplingRate_, numberOfChannels_, format_, formatDetail_)) {
+    return nullptr;
+  }
+  return writer;
+}
+
+void AudioFormatsManager::setRawOptions(const RAWOptions& options_) {
+  #ifdef ASUTILITIES_USE_MMAPPCM
+  // find, the map of the decoders never changes after the constructor
+  auto rawDecoders = m_formatsForReading.find(ASU_FORMAT_RAW);
+  if (rawDecoders == m_formatsForReading.end()) {
+    return;
+  }
+  for (auto& decoder: rawDecoders->second) {
+    AudioFormat_mmapPcm* mmapPcm = dynamic_cast<AudioFormat_mmapPcm*>(decoder.get());
+    if (mmapPcm != nullptr) {
+      mmapPcm->setRawOptions(options_);
+    }
+  }
+  #endif
+}
+
+const size_t AudioFormatsManager::kProbeCacheSize;
+
+AudioFormatTypes AudioFormatsManager::probeFile(const std::string& path_) {
+  AudioFormatTypes hint = extensionToAudioFormat(utilities::getFileExtension(path_).c_str());
+  struct stat st;
+  if (stat(path_.c_str(), &st) != 0) {
+    return hint;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_probeMutex);
+    auto cached = m_probeCache.find(path_);
+    if (cached != m_probeCache.end() && cached->second.size == (long long)st.st_size &&
+        cached->second.modified == modificationTime(st)) {
+      m_probeOrder.splice(m_probeOrder.begin(), m_probeOrder, cached->second.recent);
+      return cached->second.format;
+    }
+  }
+  FileInputStream file;
+  AudioFormatTypes format = file.open(path_) ? probeStream(file, hint) : hint;
+  if (hint != ASU_FORMAT_UNKNOWN && hint != format) {
+    std::cerr << "The file " << path_ << " is " << formatToStr(format) << ", not " << formatToStr(hint) << std::endl;
+  }
+  std::lock_guard<std::mutex> lock(m_probeMutex);
+  auto inserted = m_probeCache.insert(std::make_pair(path_, ProbeResult()));
+  ProbeResult& result = inserted.first->second;
+  if (inserted.second) {
+    m_probeOrder.push_front(path_);
+  } else {
+    m_probeOrder.splice(m_probeOrder.begin(), m_probeOrder, result.recent);
+  }
+  result.format = format;
+  result.size = st.st_size;
+  result.modified = modificationTime(st);
+  result.recent = m_probeOrder.begin();
+  // the least recently used file goes
+  if (m_probeCache.size() > kProbeCacheSize) {
+    m_probeCache.erase(m_probeOrder.back());
+    m_probeOrder.pop_back();
+  }
+  return format;
+}
+
+void AudioFormatsManager::clearProbeCache() {
+  std::lock_guard<std::mutex> lock(m_probeMutex);
+  m_probeCache.clear();
+  m_probeOrder.clear();
+}
+
+const AudioFormatsManager::DecoderList* AudioFormatsManager::decodersForStream(AudioInputStream& stream_,
+    AudioFormatTypes hint_) {
+  auto formatForStream = m_formatsForReading.find(probeStream(stream_, hint_));
+  if (formatForStream == m_formatsForReading.end()) {
+    formatForStream = m_formatsForReading.find(hint_);
+  }
+  if (formatForStream == m_formatsForReading.end()) {
+    std::cerr << "No decoder for the stream" << std::endl;
+    return nullptr;
+  }
+  return &formatForStream->second;
+}
+
+const AudioFormatsManager::DecoderList* AudioFormatsManager::decodersForFile(const std::string& path_) {
+  auto formatForFile = m_formatsForReading.find(probeFile(path_));
+  if (formatForFile == m_formatsForReading.end()) {
+    // nothing decodes what the bytes say, the extension may still be right
+    formatForFile = m_formatsForReading.find(extensionToAudioFormat(utilities::getFileExtension(path_).c_str()));
+  }
   if (formatForFile == m_formatsForReading.end()) {
     std::cerr << "No decoder for file " << path_ << std::endl;
-    return false;
+    return nullptr;
   }
-  format_ = formatForFile->first;
-  return formatForFile->second->getFileInfo(path_, samplingRate_, numberOfChannels_, bitsPerChannel_, length_);
+  return &formatForFile->second;
 }
 
 }}
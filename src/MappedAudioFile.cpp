@@ -0,0 +1,466 @@
+/*
+ * Copyright (c) 2015, Alessandro Saccoia. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL PETER THORSON BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+//  Created by Alessandro Saccoia on 10/17/26.
+
+#include "MappedAudioFile.hpp"
+#include "SampleConversion.h"
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace asu {
+namespace assets {
+
+namespace {
+
+inline uint16_t readLE16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+inline uint32_t readLE32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+inline uint16_t readBE16(const unsigned char* p) { return (p[0] << 8) | p[1]; }
+inline uint32_t readBE32(const unsigned char* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+// the sampling rate of AIFF files is an 80 bit IEEE 754 extended float
+double readExtended(const unsigned char* p) {
+  int exponent = ((p[0] & 0x7F) << 8) | p[1];
+  uint64_t mantissa = ((uint64_t)readBE32(p + 2) << 32) | readBE32(p + 6);
+  if (exponent == 0 && mantissa == 0) {
+    return 0;
+  }
+  double value = ldexp((double)mantissa, exponent - 16383 - 63);
+  return (p[0] & 0x80) ? -value : value;
+}
+
+// One functor for each encoding, turning the bytes of a sample into a float
+struct DecodeU8 {
+  static const int bytes = 1;
+  float operator()(const unsigned char* p) const { return ((int)p[0] - 128) * (1.F / 128.F); }
+};
+struct DecodeS8 {
+  static const int bytes = 1;
+  float operator()(const unsigned char* p) const { return (signed char)p[0] * (1.F / 128.F); }
+};
+template <bool BigEndian>
+struct DecodeS16 {
+  static const int bytes = 2;
+  float operator()(const unsigned char* p) const {
+    int16_t v;
+    if (BigEndian) {
+      v = (int16_t)((p[0] << 8) | p[1]);
+    } else {
+      memcpy(&v, p, 2);
+    }
+    return v * (1.F / 32768.F);
+  }
+};
+template <bool BigEndian>
+struct DecodeS24 {
+  static const int bytes = 3;
+  float operator()(const unsigned char* p) const {
+    int32_t v = BigEndian ?
+      (int32_t)(((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8)) :
+      (int32_t)(((uint32_t)p[2] << 24) | (p[1] << 16) | (p[0] << 8));
+    return (v >> 8) * (1.F / 8388608.F);
+  }
+};
+template <bool BigEndian>
+struct DecodeS32 {
+  static const int bytes = 4;
+  float operator()(const unsigned char* p) const {
+    int32_t v = (int32_t)(BigEndian ? readBE32(p) : readLE32(p));
+    return v * (1.F / 2147483648.F);
+  }
+};
+template <bool BigEndian>
+struct DecodeFloat32 {
+  static const int bytes = 4;
+  float operator()(const unsigned char* p) const {
+    uint32_t bits = BigEndian ? readBE32(p) : readLE32(p);
+    float v;
+    memcpy(&v, &bits, 4);
+    return v;
+  }
+};
+template <bool BigEndian>
+struct DecodeFloat64 {
+  static const int bytes = 8;
+  float operator()(const unsigned char* p) const {
+    uint64_t bits = BigEndian ?
+      ((uint64_t)readBE32(p) << 32) | readBE32(p + 4) :
+      ((uint64_t)readLE32(p + 4) << 32) | readLE32(p);
+    double v;
+    memcpy(&v, &bits, 8);
+    return (float)v;
+  }
+};
+
+// little endian samples can be handed to SampleConversion as they are stored,
+// if the host is little endian too and they are aligned for their type
+template <class T>
+bool isNative(const unsigned char* p) {
+  const uint16_t one = 1;
+  unsigned char low;
+  memcpy(&low, &one, 1);
+  return low == 1 && ((uintptr_t)p % sizeof(T)) == 0;
+}
+
+// The mono and stereo cases are unrolled so that the compiler can keep the
+// inner loop branch free and vectorize it
+template <class Decoder>
+void deinterleave(const unsigned char* in, float* const* out, unsigned int channels, size_t numFrames) {
+  Decoder decode;
+  const size_t stride = Decoder::bytes * channels;
+  if (channels == 1) {
+    float* o0 = out[0];
+    for (size_t i = 0; i < numFrames; ++i) {
+      o0[i] = decode(in + i * Decoder::bytes);
+    }
+  } else if (channels == 2) {
+    float* o0 = out[0];
+    float* o1 = out[1];
+    for (size_t i = 0; i < numFrames; ++i) {
+      o0[i] = decode(in + i * stride);
+      o1[i] = decode(in + i * stride + Decoder::bytes);
+    }
+  } else {
+    for (unsigned int ch = 0; ch < channels; ++ch) {
+      const unsigned char* pin = in + ch * Decoder::bytes;
+      float* o = out[ch];
+      for (size_t i = 0; i < numFrames; ++i) {
+        o[i] = decode(pin + i * stride);
+      }
+    }
+  }
+}
+
+}
+
+MappedAudioFile::MappedAudioFile() :
+  m_mapping(nullptr),
+  m_mappingSize(0),
+  m_ownsMapping(false),
+  m_data(nullptr),
+  m_format(ASU_FORMAT_UNKNOWN),
+  m_samplingRate(0),
+  m_numberOfChannels(0),
+  m_bitsPerSample(0),
+  m_sampleFormat(ASU_PCM_S16),
+  m_bigEndian(false),
+  m_bytesPerFrame(0),
+  m_length(0) {
+}
+
+MappedAudioFile::~MappedAudioFile() {
+  close();
+}
+
+bool MappedAudioFile::open(const std::string& path, const RAWOptions& rawOptions_) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  m_mappingSize = st.st_size;
+  void* mapping = mmap(NULL, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    m_mappingSize = 0;
+    return false;
+  }
+  m_mapping = mapping;
+  m_ownsMapping = true;
+  madvise(m_mapping, m_mappingSize, MADV_SEQUENTIAL);
+  bool isRaw = extensionToAudioFormat(path.substr(path.find_last_of('.') + 1).c_str()) == ASU_FORMAT_RAW;
+  return parse(isRaw, rawOptions_);
+}
+
+bool MappedAudioFile::open(const void* data, size_t size) {
+  close();
+  if (data == nullptr || size == 0) {
+    return false;
+  }
+  m_mapping = const_cast<void*>(data);
+  m_mappingSize = size;
+  m_ownsMapping = false;
+  return parse(false, RAWOptions());
+}
+
+bool MappedAudioFile::parse(bool isRaw, const RAWOptions& rawOptions_) {
+  bool parsed = false;
+  const unsigned char* header = (const unsigned char*)m_mapping;
+  if (m_mappingSize >= 12 && memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0) {
+    parsed = parseWav();
+  } else if (m_mappingSize >= 12 && memcmp(header, "FORM", 4) == 0 &&
+    (memcmp(header + 8, "AIFF", 4) == 0 || memcmp(header + 8, "AIFC", 4) == 0)) {
+    parsed = parseAiff();
+  } else if (isRaw) {
+    parsed = parseRaw(rawOptions_);
+  }
+  if (!parsed || m_numberOfChannels == 0) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedAudioFile::close() {
+  if (m_mapping != nullptr && m_ownsMapping) {
+    munmap(m_mapping, m_mappingSize);
+  }
+  m_mapping = nullptr;
+  m_ownsMapping = false;
+  m_mappingSize = 0;
+  m_data = nullptr;
+  m_length = 0;
+  m_numberOfChannels = 0;
+  m_format = ASU_FORMAT_UNKNOWN;
+}
+
+bool MappedAudioFile::parseWav() {
+  const unsigned char* base = (const unsigned char*)m_mapping;
+  size_t position = 12;
+  bool hasFormat = false;
+  unsigned int encoding = 0;
+  while (position + 8 <= m_mappingSize) {
+    const unsigned char* chunk = base + position;
+    size_t chunkSize = readLE32(chunk + 4);
+    if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16 && position + 8 + chunkSize <= m_mappingSize) {
+      encoding = readLE16(chunk + 8);
+      m_numberOfChannels = readLE16(chunk + 10);
+      m_samplingRate = readLE32(chunk + 12);
+      m_bitsPerSample = readLE16(chunk + 22);
+      // WAVE_FORMAT_EXTENSIBLE, the real encoding is in the sub format GUID
+      if (encoding == 0xFFFE && chunkSize >= 40) {
+        encoding = readLE16(chunk + 32);
+      }
+      hasFormat = true;
+    } else if (memcmp(chunk, "data", 4) == 0 && hasFormat) {
+      if (encoding == 1) {
+        switch (m_bitsPerSample) {
+          case 8: m_sampleFormat = ASU_PCM_U8; break;
+          case 16: m_sampleFormat = ASU_PCM_S16; break;
+          case 24: m_sampleFormat = ASU_PCM_S24; break;
+          case 32: m_sampleFormat = ASU_PCM_S32; break;
+          default: return false;
+        }
+      } else if (encoding == 3) {
+        switch (m_bitsPerSample) {
+          case 32: m_sampleFormat = ASU_PCM_FLOAT32; break;
+          case 64: m_sampleFormat = ASU_PCM_FLOAT64; break;
+          default: return false;
+        }
+      } else {
+        // compressed, leave it to the other decoders
+        return false;
+      }
+      m_format = ASU_FORMAT_WAV;
+      m_bigEndian = false;
+      m_data = chunk + 8;
+      m_bytesPerFrame = (m_bitsPerSample / 8) * m_numberOfChannels;
+      if (m_bytesPerFrame == 0) {
+        return false;
+      }
+      chunkSize = std::min(chunkSize, m_mappingSize - position - 8);
+      m_length = chunkSize / m_bytesPerFrame;
+      return true;
+    }
+    position += 8 + chunkSize + (chunkSize & 1);
+  }
+  return false;
+}
+
+bool MappedAudioFile::parseAiff() {
+  const unsigned char* base = (const unsigned char*)m_mapping;
+  const bool isAifc = memcmp(base + 8, "AIFC", 4) == 0;
+  size_t position = 12;
+  bool hasFormat = false;
+  unsigned long numSampleFrames = 0;
+  m_bigEndian = true;
+  while (position + 8 <= m_mappingSize) {
+    const unsigned char* chunk = base + position;
+    size_t chunkSize = readBE32(chunk + 4);
+    if (memcmp(chunk, "COMM", 4) == 0 && chunkSize >= 18 && position + 8 + chunkSize <= m_mappingSize) {
+      m_numberOfChannels = readBE16(chunk + 8);
+      numSampleFrames = readBE32(chunk + 10);
+      m_bitsPerSample = readBE16(chunk + 14);
+      m_samplingRate = readExtended(chunk + 16);
+      bool isFloat = false;
+      if (isAifc && chunkSize >= 22) {
+        const unsigned char* compression = chunk + 26;
+        if (memcmp(compression, "sowt", 4) == 0) {
+          m_bigEndian = false;
+        } else if (memcmp(compression, "fl32", 4) == 0 || memcmp(compression, "FL32", 4) == 0) {
+          isFloat = true;
+          m_bitsPerSample = 32;
+        } else if (memcmp(compression, "fl64", 4) == 0 || memcmp(compression, "FL64", 4) == 0) {
+          isFloat = true;
+          m_bitsPerSample = 64;
+        } else if (memcmp(compression, "NONE", 4) != 0 && memcmp(compression, "twos", 4) != 0) {
+          return false;
+        }
+      }
+      if (isFloat) {
+        m_sampleFormat = m_bitsPerSample == 32 ? ASU_PCM_FLOAT32 : ASU_PCM_FLOAT64;
+      } else {
+        // sample sizes that are not a multiple of 8 are left justified
+        switch ((m_bitsPerSample + 7) / 8) {
+          case 1: m_sampleFormat = ASU_PCM_S8; m_bitsPerSample = 8; break;
+          case 2: m_sampleFormat = ASU_PCM_S16; m_bitsPerSample = 16; break;
+          case 3: m_sampleFormat = ASU_PCM_S24; m_bitsPerSample = 24; break;
+          case 4: m_sampleFormat = ASU_PCM_S32; m_bitsPerSample = 32; break;
+          default: return false;
+        }
+      }
+      hasFormat = true;
+    } else if (memcmp(chunk, "SSND", 4) == 0 && hasFormat && chunkSize >= 8) {
+      size_t dataOffset = readBE32(chunk + 8);
+      m_format = ASU_FORMAT_AIFF;
+      m_data = chunk + 16 + dataOffset;
+      m_bytesPerFrame = (m_bitsPerSample / 8) * m_numberOfChannels;
+      if (m_bytesPerFrame == 0 || position + 16 + dataOffset > m_mappingSize) {
+        return false;
+      }
+      size_t available = std::min(chunkSize - 8 - dataOffset, m_mappingSize - position - 16 - dataOffset);
+      m_length = std::min((unsigned long)(available / m_bytesPerFrame), numSampleFrames);
+      return true;
+    }
+    position += 8 + chunkSize + (chunkSize & 1);
+  }
+  return false;
+}
+
+bool MappedAudioFile::parseRaw(const RAWOptions& rawOptions_) {
+  if (rawOptions_.headerSize >= m_mappingSize) {
+    return false;
+  }
+  m_numberOfChannels = rawOptions_.numberOfChannels;
+  m_samplingRate = rawOptions_.samplingRate;
+  m_bitsPerSample = rawOptions_.bitsPerSample;
+  m_bigEndian = rawOptions_.bigEndian;
+  if (rawOptions_.isFloat) {
+    switch (m_bitsPerSample) {
+      case 32: m_sampleFormat = ASU_PCM_FLOAT32; break;
+      case 64: m_sampleFormat = ASU_PCM_FLOAT64; break;
+      default: return false;
+    }
+  } else {
+    switch (m_bitsPerSample) {
+      case 8: m_sampleFormat = ASU_PCM_S8; break;
+      case 16: m_sampleFormat = ASU_PCM_S16; break;
+      case 24: m_sampleFormat = ASU_PCM_S24; break;
+      case 32: m_sampleFormat = ASU_PCM_S32; break;
+      default: return false;
+    }
+  }
+  m_format = ASU_FORMAT_RAW;
+  m_data = (const unsigned char*)m_mapping + rawOptions_.headerSize;
+  m_bytesPerFrame = (m_bitsPerSample / 8) * m_numberOfChannels;
+  if (m_bytesPerFrame == 0) {
+    return false;
+  }
+  m_length = (m_mappingSize - rawOptions_.headerSize) / m_bytesPerFrame;
+  return true;
+}
+
+size_t MappedAudioFile::convertFrames(float* const* channels, unsigned long startFrame, size_t numFrames) const {
+  if (m_data == nullptr || startFrame >= m_length) {
+    return 0;
+  }
+  numFrames = std::min(numFrames, (size_t)(m_length - startFrame));
+  const unsigned char* in = m_data + startFrame * m_bytesPerFrame;
+  switch (m_sampleFormat) {
+    case ASU_PCM_U8:
+      deinterleave<DecodeU8>(in, channels, m_numberOfChannels, numFrames);
+      break;
+    case ASU_PCM_S8:
+      deinterleave<DecodeS8>(in, channels, m_numberOfChannels, numFrames);
+      break;
+    case ASU_PCM_S16:
+      if (m_bigEndian) {
+        deinterleave<DecodeS16<true> >(in, channels, m_numberOfChannels, numFrames);
+      } else if (isNative<int16_t>(in)) {
+        conversion::deinterleave((const int16_t*)in, channels, m_numberOfChannels, numFrames);
+      } else {
+        deinterleave<DecodeS16<false> >(in, channels, m_numberOfChannels, numFrames);
+      }
+      break;
+    case ASU_PCM_S24:
+      if (m_bigEndian) {
+        deinterleave<DecodeS24<true> >(in, channels, m_numberOfChannels, numFrames);
+      } else {
+        conversion::deinterleaveInt24(in, channels, m_numberOfChannels, numFrames);
+      }
+      break;
+    case ASU_PCM_S32:
+      if (m_bigEndian) {
+        deinterleave<DecodeS32<true> >(in, channels, m_numberOfChannels, numFrames);
+      } else if (isNative<int32_t>(in)) {
+        conversion::deinterleave((const int32_t*)in, channels, m_numberOfChannels, numFrames);
+      } else {
+        deinterleave<DecodeS32<false> >(in, channels, m_numberOfChannels, numFrames);
+      }
+      break;
+    case ASU_PCM_FLOAT32:
+      if (m_bigEndian) {
+        deinterleave<DecodeFloat32<true> >(in, channels, m_numberOfChannels, numFrames);
+      } else if (isNative<float>(in)) {
+        conversion::deinterleave((const float*)in, channels, m_numberOfChannels, numFrames);
+      } else {
+        deinterleave<DecodeFloat32<false> >(in, channels, m_numberOfChannels, numFrames);
+      }
+      break;
+    case ASU_PCM_FLOAT64:
+      if (m_bigEndian) {
+        deinterleave<DecodeFloat64<true> >(in, channels, m_numberOfChannels, numFrames);
+      } else {
+        deinterleave<DecodeFloat64<false> >(in, channels, m_numberOfChannels, numFrames);
+      }
+      break;
+  }
+  return numFrames;
+}
+
+size_t MappedAudioFile::readFrames(AudioBuffer& buffer, unsigned long startFrame, size_t numFrames) const {
+  if (buffer.channels != m_numberOfChannels || buffer.size < numFrames) {
+    buffer.resize(m_numberOfChannels, numFrames);
+  }
+  size_t count = convertFrames(buffer.data, startFrame, numFrames);
+  buffer.usedSize = count;
+  buffer.markAsWritten();
+  return count;
+}
+
+}
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <cmath>
+#include <cassert>
+#include "AudioBuffer.hpp"
+
+// built with the library when fdk-aac is enabled (ASUTILITIES_USE_AAC)
+#ifdef ASUTILITIES_USE_AAC
+#include "AudioFormat_aac.hpp"
+
+using namespace asu;
+using namespace asu::assets;
+
+#define FILENAME "aacRoundTrip.aac"
+#define SAMPLING_RATE 44100.F
+
+// signal to noise ratio of decoded against original, decoded delayed by lag
+static double snr(const AudioBuffer& original, const AudioBuffer& decoded, size_t channel, int lag) {
+  double signal = 0, noise = 0;
+  // the first and last frames are left out, the codec smears them
+  for (size_t i = 4096; i + 4096 < original.usedSize; ++i) {
+    const double difference = decoded.data[channel][i + lag] - original.data[channel][i];
+    signal += original.data[channel][i] * original.data[channel][i];
+    noise += difference * difference;
+  }
+  return 10 * log10(signal / noise);
+}
+#endif
+
+int main (int argc, char** argv) {
+#ifndef ASUTILITIES_USE_AAC
+  std::cerr << "fdk-aac is not enabled, nothing to test" << std::endl;
+#else
+  AudioFormat_aac aac;
+
+  #pragma mark Test the decoded length and alignment match the input
+  for (unsigned int channels = 1; channels <= 2; ++channels) {
+    const size_t lengths[] = { 44100, 50000, 12345 };
+    for (size_t length : lengths) {
+      // a chirp, so that a wrong offset can't line up with another period
+      AudioBuffer input(channels, length);
+      for (size_t ch = 0; ch < channels; ++ch) {
+        for (size_t i = 0; i < length; ++i) {
+          input[ch][i] = 0.5F * sin(2 * M_PI * (100. + i * 0.05) * i / SAMPLING_RATE + ch);
+        }
+      }
+      assert(aac.writeFile(FILENAME, input, SAMPLING_RATE, ASU_FORMAT_AAC));
+
+      float samplingRate, infoSamplingRate;
+      unsigned int numberOfChannels, bitsPerChannel;
+      unsigned long infoLength;
+      assert(aac.getFileInfo(FILENAME, infoSamplingRate, numberOfChannels, bitsPerChannel, infoLength));
+      assert(infoSamplingRate == SAMPLING_RATE && numberOfChannels == channels);
+
+      AudioBuffer decoded;
+      assert(aac.loadFile(FILENAME, decoded, samplingRate));
+      // ADTS has no exact length, the last frame is decoded whole
+      assert(samplingRate == SAMPLING_RATE && decoded.usedChannels == channels && decoded.usedSize == infoLength);
+      assert(decoded.usedSize >= length && decoded.usedSize < length + 1024);
+      for (size_t ch = 0; ch < channels; ++ch) {
+        const double aligned = snr(input, decoded, ch, 0);
+        assert(aligned > 15. && aligned > snr(input, decoded, ch, 1) && aligned > snr(input, decoded, ch, -1));
+      }
+
+      #pragma mark Test a range is the same frames as in the whole file
+      const size_t starts[] = { 0, 1, 1024, 2047, 10001, decoded.usedSize - 500 };
+      for (size_t start : starts) {
+        AudioBuffer range;
+        assert(aac.loadRange(FILENAME, start, 3000, range, samplingRate));
+        assert(range.usedSize == std::min((size_t)3000, decoded.usedSize - start));
+        for (size_t ch = 0; ch < channels; ++ch) {
+          for (size_t i = 0; i < range.usedSize; ++i) {
+            assert(fabs(range.data[ch][i] - decoded.data[ch][start + i]) < 1e-6F);
+          }
+        }
+      }
+    }
+  }
+  remove(FILENAME);
+#endif
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+#define NUM_THREADS 8
+#define ITERATIONS 20000
+
+int main (int argc, char** argv) {
+  PooledAudioAllocator& pool = PooledAudioAllocator::instance();
+
+  #pragma mark Test alignment and size classes
+  {
+    for (size_t bytes = 1; bytes < 100000; bytes = bytes * 3 + 1) {
+      void* block = pool.allocate(bytes);
+      assert(((uintptr_t)block % ASU_AUDIO_ALIGNMENT) == 0);
+      assert(pool.getGoodSize(bytes) >= bytes);
+      pool.deallocate(block, bytes);
+    }
+    // a freed block is reused for the next request of the same class
+    void* first = pool.allocate(3000);
+    pool.deallocate(first, 3000);
+    void* second = pool.allocate(4096);
+    assert(first == second);
+    pool.deallocate(second, 4096);
+  }
+
+  #pragma mark Test capacity
+  {
+    AudioBuffer buf(&pool);
+    buf.reserve(2, 48000);
+    assert(buf.channels == 0);
+    assert(buf.getCapacity() >= 2 * 48000);
+    buf.resize(2, 48000);
+    float* storage = buf.data[0];
+    assert(((uintptr_t)storage % ASU_AUDIO_ALIGNMENT) == 0);
+    // shrinking and growing back reuse the same memory
+    buf.resize(1, 512);
+    assert(buf.data[0] == storage);
+    buf.resize(2, 48000);
+    assert(buf.data[0] == storage);
+    assert(buf.getAllocator() == &pool);
+
+    // reserve keeps the samples
+    buf.createNoise(-1.F, 1.F);
+    AudioBuffer copy(buf);
+    assert(copy.getAllocator() == &pool);
+    buf.reserve(4, 96000);
+    assert(buf.channels == 2 && buf.size == 48000);
+    for (size_t ch = 0; ch < 2; ++ch) {
+      assert(std::equal(buf.data[ch], buf.data[ch] + buf.size, copy.data[ch]));
+    }
+  }
+
+  #pragma mark Test default allocator
+  {
+    assert(AudioAllocator::getDefault() == &HeapAudioAllocator::instance());
+    AudioAllocator::setDefault(&pool);
+    AudioBuffer buf(2, 1024);
+    assert(buf.getAllocator() == &pool);
+    AudioAllocator::setDefault(nullptr);
+    assert(AudioAllocator::getDefault() == &HeapAudioAllocator::instance());
+  }
+
+  #pragma mark Test many threads resizing buffers
+  {
+    auto worker = [](AudioAllocator* allocator, int seed) {
+      AudioBuffer buf(allocator);
+      for (int i = 0; i < ITERATIONS; ++i) {
+        size_t frames = 256 + ((i * 7919 + seed * 104729) % 8192);
+        buf.resize(1 + (i % 2), frames);
+        buf.fill(1.F, frames);
+        buf.applyGain(0.5F);
+        buf.release();
+      }
+    };
+    for (int usePool = 0; usePool < 2; ++usePool) {
+      AudioAllocator* allocator = usePool ? (AudioAllocator*)&pool : (AudioAllocator*)&HeapAudioAllocator::instance();
+      auto start = std::chrono::high_resolution_clock::now();
+      std::vector<std::thread> threads;
+      for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.push_back(std::thread(worker, allocator, t));
+      }
+      for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+      }
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+      std::cerr << (usePool ? "pooled" : "heap") << " allocator: " << elapsed.count() << " ms" << std::endl;
+    }
+    // the blocks of the threads that exited are back in the shared lists
+    assert(pool.getCachedBytes() > 0);
+    pool.trim();
+    assert(pool.getCachedBytes() == 0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <cstdint>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+#define N 1001
+
+static bool isAligned(const void* ptr) {
+  return ((uintptr_t)ptr % ASU_AUDIO_ALIGNMENT) == 0;
+}
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test channel starts and stride
+  {
+    AudioBuffer packed(4, N);
+    assert(packed.getLayout() == ASU_LAYOUT_PACKED);
+    assert(packed.getStride() == N);
+    assert(packed.data[1] == packed.data[0] + N);
+
+    AudioBuffer aligned(4, N, ASU_LAYOUT_ALIGNED);
+    assert(aligned.getStride() % (ASU_AUDIO_ALIGNMENT / sizeof(float)) == 0);
+    assert(aligned.getStride() >= N);
+    for (size_t ch = 0; ch < aligned.channels; ++ch) {
+      assert(isAligned(aligned.data[ch]));
+    }
+
+    // the padding can be written without touching the next channel
+    AudioBuffer padded(2, N, ASU_LAYOUT_ALIGNED, 16);
+    assert(padded.getStride() >= N + 16);
+    padded.fill(1.F, N);
+    float* left = padded[0];
+    std::fill(left + N, left + N + 16, 7.F);
+    assert(padded[1][0] == 1.F);
+
+    // resizing keeps the layout
+    padded.resize(3, 10);
+    assert(padded.getStride() >= 10 + 16);
+    for (size_t ch = 0; ch < padded.channels; ++ch) {
+      assert(isAligned(padded.data[ch]));
+    }
+    assert(padded.getCapacity() >= 10);
+  }
+
+  #pragma mark Test changing the layout keeps the samples
+  {
+    AudioBuffer buf(3, N);
+    buf.createNoise(-1.F, 1.F);
+    buf.setChannelIsConstant(2, true, 0.5F);
+    AudioBuffer reference(buf);
+    buf.setLayout(ASU_LAYOUT_ALIGNED, 8);
+    assert(buf.getLayout() == ASU_LAYOUT_ALIGNED && buf.getTailPadding() == 8);
+    for (size_t ch = 0; ch < buf.channels; ++ch) {
+      assert(isAligned(buf.data[ch]));
+      assert(std::equal(buf[ch], buf[ch] + N, reference[ch]));
+    }
+
+    // copies and moves have the same layout as the source
+    AudioBuffer copy(buf);
+    assert(copy.getLayout() == ASU_LAYOUT_ALIGNED && copy.getStride() == buf.getStride());
+    AudioBuffer moved(std::move(copy));
+    assert(moved.getLayout() == ASU_LAYOUT_ALIGNED && isAligned(moved.data[1]));
+
+    // reserve grows the storage without moving the channels out of alignment
+    buf.reserve(3, 4 * N);
+    for (size_t ch = 0; ch < buf.channels; ++ch) {
+      assert(isAligned(buf.data[ch]));
+      assert(std::equal(buf[ch], buf[ch] + N, reference[ch]));
+    }
+  }
+
+  #pragma mark Test processing gives the same result in both layouts
+  {
+    AudioBuffer packed(2, N);
+    packed.createNoise(-1.F, 1.F);
+    AudioBuffer aligned(2, N, ASU_LAYOUT_ALIGNED);
+    aligned = packed;
+    assert(aligned.getLayout() == ASU_LAYOUT_ALIGNED);
+
+    AudioBuffer noise(2, N);
+    noise.createNoise(-1.F, 1.F);
+    packed.sumWithGain(noise, N, 0.3F);
+    aligned.sumWithGain(noise, N, 0.3F);
+    packed.applyGain(0.7F);
+    aligned.applyGain(0.7F);
+    packed.convertToMono();
+    aligned.convertToMono();
+    assert(std::equal(packed[0], packed[0] + N, aligned[0]));
+  }
+
+  return 0;
+}
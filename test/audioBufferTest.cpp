@@ -3,7 +3,7 @@
 #include <chrono>
 #include "AudioBuffer.hpp"
 
-using namespace dinahmoe;
+using namespace asu;
 
 int main (int argc, char** argv) {
 
@@ -32,7 +32,7 @@ int main (int argc, char** argv) {
     
     buf1.createNoise(-1.0F, 1.0F);
     assert(!buf1.channelIsConstant[0]);
-    assert(!buf1.channelIsConstant[2]);
+    assert(!buf1.channelIsConstant[1]);
     // check if createNoise produces values within the expected range
     assert(std::find_if(buf1.getChannelData(0), buf1.getChannelData(0) + 1000,
       [](const float& val_) {
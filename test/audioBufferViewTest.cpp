@@ -0,0 +1,118 @@
+#include <iostream>
+#include <vector>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+#define N 4096
+
+static bool near(float a, float b) {
+  return fabs(a - b) < 1e-5F;
+}
+
+static AudioBuffer makeNoise(size_t nchan, size_t size) {
+  AudioBuffer buf(nchan, size);
+  buf.createNoise(-1.0F, 1.0F);
+  return buf;
+}
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test move construction and assignment
+  {
+    AudioBuffer a(2, N);
+    a.createNoise(-1.0F, 1.0F);
+    float* samples = a.data[0];
+    AudioBuffer b(std::move(a));
+    // the samples changed owner without being copied
+    assert(b.data[0] == samples);
+    assert(b.channels == 2 && b.size == N && b.usedSize == N);
+    assert(a.channels == 0 && a.size == 0 && a.data == NULL);
+
+    AudioBuffer c(1, 16);
+    c = std::move(b);
+    assert(c.data[0] == samples);
+    assert(b.channels == 0 && b.data == NULL);
+
+    // the moved from buffer can be used again
+    b.resize(1, 8);
+    b.fill(1.0F, 8);
+    assert(b.getChannelData(0)[7] == 1.0F);
+
+    std::vector<AudioBuffer> buffers;
+    buffers.push_back(makeNoise(2, N));
+    buffers.push_back(makeNoise(1, N));
+    assert(buffers[0].channels == 2 && buffers[1].channels == 1);
+
+    // constant channels travel with the samples
+    AudioBuffer silent(2, N);
+    AudioBuffer moved(std::move(silent));
+    assert(moved.isSilent());
+  }
+
+  #pragma mark Test views over external memory
+  {
+    std::vector<float> left(N), right(N);
+    for (size_t i = 0; i < N; ++i) {
+      left[i] = (float)i;
+      right[i] = -(float)i;
+    }
+    float* channels[2] = { &left[0], &right[0] };
+    AudioBufferView view(channels, 2, 0, N);
+    assert(view.getNumberOfChannels() == 2 && view.getLength() == N);
+
+    AudioBufferView middle = view.getRange(100, 200);
+    assert(middle[0][0] == 100.0F && middle[1][199] == -299.0F);
+    applyGain(middle, 2.0F);
+    assert(left[99] == 99.0F && left[100] == 200.0F && left[299] == 598.0F && left[300] == 300.0F);
+
+    // a buffer can read from a view without the samples being copied first
+    AudioBuffer buf(2, N);
+    buf.sum(view, N);
+    assert(buf.data[0][10] == 10.0F && buf.data[1][10] == -10.0F);
+    buf.sumWithGain(view, N, 0.5F);
+    assert(buf.data[0][10] == 15.0F && buf.data[1][10] == -15.0F);
+
+    // mono views are summed to both channels
+    ConstAudioBufferView mono(view.getRange(0, N));
+    AudioBufferView monoLeft(channels, 1, 0, N);
+    AudioBuffer fromMono(2, N);
+    fromMono.sum(monoLeft, N);
+    assert(fromMono.data[1][400] == 400.0F);
+
+    // or copied into a buffer that owns them
+    AudioBuffer owned(mono);
+    assert(owned.channels == 2 && owned.size == N);
+    assert(owned.data[0] != channels[0]);
+    assert(std::equal(left.begin(), left.end(), owned.data[0]));
+  }
+
+  #pragma mark Test views of buffers
+  {
+    AudioBuffer buf(2, N);
+    buf.fill(0.25F, N);
+    // constant channels are written out before the view is handed out
+    AudioBufferView view = buf.getView(N / 2);
+    assert(view.getLength() == N / 2);
+    assert(view[0][0] == 0.25F && view[1][N / 2 - 1] == 0.25F);
+    fill(view, 1.0F);
+    assert(buf.data[0][N / 2 - 1] == 0.25F && buf.data[0][N / 2] == 1.0F);
+    assert(!buf.channelIsConstant[0]);
+
+    AudioBuffer other(2, N);
+    other.createNoise(-1.0F, 1.0F);
+    AudioBuffer expected(other);
+    expected.sum(buf, N);
+    sum(buf.getConstView(), other.getView());
+    for (size_t ch = 0; ch < 2; ++ch) {
+      for (size_t i = 0; i < N; ++i) {
+        assert(near(other.data[ch][i], expected.data[ch][i]));
+      }
+    }
+
+    copy(buf.getConstView(0, 16), other.getView(0, 16));
+    assert(other.data[1][15] == 0.25F && other.data[1][16] != 0.25F);
+  }
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cstdio>
+#include <type_traits>
+#include "AudioInputStream.hpp"
+
+using namespace asu::assets;
+
+int main (int argc, char** argv) {
+  std::vector<unsigned char> bytes(1000);
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = (unsigned char)(i * 7);
+  }
+
+  #pragma mark Test memory streams
+  {
+    MemoryInputStream stream(bytes.data(), bytes.size());
+    assert(stream.getLength() == 1000 && stream.getData() == bytes.data());
+    unsigned char chunk[300];
+    assert(stream.read(chunk, 300) == 300 && chunk[299] == bytes[299]);
+    assert(stream.tell() == 300);
+    assert(stream.seek(900) && stream.read(chunk, 300) == 100 && chunk[0] == bytes[900]);
+    assert(stream.read(chunk, 300) == 0);
+    assert(!stream.seek(1001) && stream.tell() == 1000);
+
+    // the bytes can be moved in, the stream owns them
+    std::vector<unsigned char> copy(bytes);
+    const unsigned char* owned = copy.data();
+    MemoryInputStream owner(std::move(copy));
+    assert(owner.getData() == owned && owner.getLength() == 1000);
+    // a copy would point into the bytes of the original
+    static_assert(!std::is_copy_constructible<MemoryInputStream>::value, "MemoryInputStream must not be copyable");
+  }
+
+  #pragma mark Test file streams
+  {
+    const char* path = "/tmp/audioInputStreamTest.bin";
+    FILE* file = fopen(path, "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+
+    FileInputStream stream;
+    assert(!stream.open("/tmp/this/does/not/exist"));
+    assert(stream.open(path) && stream.getLength() == 1000);
+    assert(stream.getData() == nullptr);
+    unsigned char chunk[10];
+    assert(stream.seek(500) && stream.read(chunk, 10) == 10 && chunk[3] == bytes[503]);
+    assert(stream.tell() == 510);
+
+    // streams without memory are read in one piece when a backend needs it
+    std::vector<unsigned char> storage;
+    const void* data = getStreamData(stream, storage);
+    assert(data == storage.data() && storage == bytes);
+    MemoryInputStream memory(bytes.data(), bytes.size());
+    assert(getStreamData(memory, storage) == bytes.data());
+    remove(path);
+  }
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <chrono>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+// the FFT path rounds differently from the direct sums
+static void assertClose(const AudioBuffer& a, const AudioBuffer& b, float tolerance) {
+  assert(a.usedChannels == b.usedChannels && a.usedSize == b.usedSize);
+  for (size_t ch = 0; ch < a.usedChannels; ++ch) {
+    for (size_t i = 0; i < a.usedSize; ++i) {
+      assert(fabs(a.getChannelData(ch)[i] - b.getChannelData(ch)[i]) < tolerance);
+    }
+  }
+}
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test the FFT against a plain DFT
+  {
+    for (size_t size = 4; size <= 256; size *= 2) {
+      RealFFTC<double> fft(size);
+      std::vector<double> signal(size), re(size / 2 + 1), im(size / 2 + 1), back(size);
+      for (size_t i = 0; i < size; ++i) {
+        signal[i] = sin(i * 0.37) + (i % 3) * 0.25;
+      }
+      fft.forward(&signal[0], &re[0], &im[0]);
+      for (size_t k = 0; k <= size / 2; ++k) {
+        double dftRe = 0, dftIm = 0;
+        for (size_t n = 0; n < size; ++n) {
+          dftRe += signal[n] * cos(2 * M_PI * k * n / size);
+          dftIm -= signal[n] * sin(2 * M_PI * k * n / size);
+        }
+        assert(fabs(re[k] - dftRe) < 1e-9 && fabs(im[k] - dftIm) < 1e-9);
+      }
+      fft.inverse(&re[0], &im[0], &back[0]);
+      for (size_t i = 0; i < size; ++i) {
+        assert(fabs(back[i] - signal[i]) < 1e-12);
+      }
+    }
+    RealFFT invalid;
+    assert(!invalid.init(48) && !invalid.init(2));
+  }
+
+  #pragma mark Test convolve matches convolveTd
+  {
+    const size_t lengths[] = { 1, 7, 64, 300, 1000 };
+    for (size_t inputLength : lengths) {
+      for (size_t impulseLength : lengths) {
+        for (size_t blockSize = 2; blockSize <= 512; blockSize *= 4) {
+          AudioBuffer input(2, inputLength), impulse(1, impulseLength), direct, partitioned;
+          input.createNoise(-1.F, 1.F);
+          impulse.createNoise(-.5F, .5F);
+          AudioBuffer::convolveTd(input, impulse, direct);
+          AudioBuffer::convolve(input, impulse, partitioned, blockSize);
+          assertClose(direct, partitioned, 1e-4F);
+        }
+      }
+    }
+  }
+
+  #pragma mark Test the impulse channels map like convolveTd
+  {
+    AudioBuffer input(3, 2000), impulse(2, 700), direct, partitioned;
+    input.createNoise(-1.F, 1.F);
+    impulse.createNoise(-.5F, .5F);
+    AudioBuffer::convolveTd(input, impulse, direct);
+    AudioBuffer::convolve(input, impulse, partitioned);
+    assertClose(direct, partitioned, 1e-4F);
+    // a unit impulse gives the input back
+    AudioBuffer unit(1, 1), identity;
+    unit[0][0] = 1.F;
+    AudioBuffer::convolve(input, unit, identity);
+    assertClose(input, identity, 1e-6F);
+
+    // constant buffers are read without being written out
+    AudioBuffer dc(1, 3), steps;
+    dc.setIsConstant(true, .5F);
+    input.setChannelIsConstant(1, true, 1.F);
+    const AudioBuffer& sharedInput = input;
+    AudioBuffer::convolve(sharedInput, dc, steps);
+    assert(dc.channelIsConstant[0] && input.channelIsConstant[1]);
+    assert(fabs(steps[1][0] - .5F) < 1e-6F && fabs(steps[1][2] - 1.5F) < 1e-6F && fabs(steps[1][2001] - .5F) < 1e-6F);
+  }
+
+  #pragma mark Test streaming blocks give the one-shot result
+  {
+    const size_t blockSize = 128, blocks = 20;
+    AudioBuffer input(2, blockSize * blocks), impulse(2, 1000), oneShot;
+    input.createNoise(-1.F, 1.F);
+    impulse.createNoise(-.5F, .5F);
+    AudioBuffer::convolve(input, impulse, oneShot, blockSize);
+
+    Convolver convolver;
+    assert(convolver.init(impulse.getConstView(), 2, blockSize));
+    assert(convolver.getNumberOfPartitions() == 8);
+    AudioBuffer streamed(2, blockSize * blocks);
+    for (int pass = 0; pass < 2; ++pass) {
+      for (size_t b = 0; b < blocks; ++b) {
+        convolver.process(input.getConstView(b * blockSize, blockSize), streamed.getView(b * blockSize, blockSize));
+      }
+      for (size_t ch = 0; ch < 2; ++ch) {
+        for (size_t i = 0; i < streamed.size; ++i) {
+          assert(fabs(streamed[ch][i] - oneShot[ch][i]) < 1e-5F);
+        }
+      }
+      // after a reset it starts over
+      convolver.reset();
+    }
+    assert(!convolver.init(impulse.getConstView(), 2, 100));
+  }
+
+  #pragma mark Time a long impulse response
+  {
+    const size_t rate = 44100;
+    AudioBuffer input(2, rate * 10), impulse(2, rate * 3), output;
+    input.createNoise(-1.F, 1.F);
+    impulse.createNoise(-.1F, .1F);
+    auto start = std::chrono::high_resolution_clock::now();
+    AudioBuffer::convolve(input, impulse, output);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cerr << "10 s stereo through a 3 s response: " << elapsed.count() << " ms" << std::endl;
+    assert(output.size == input.size + impulse.size - 1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "AudioFormatTypes.h"
+
+using namespace asu::assets;
+
+static std::vector<unsigned char> bytes(const char* str, size_t size) {
+  return std::vector<unsigned char>(str, str + size);
+}
+
+static AudioFormatTypes probe(const std::vector<unsigned char>& header) {
+  return probeAudioFormat(header.data(), header.size());
+}
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test container formats
+  {
+    assert(probe(bytes("RIFF\x24\x00\x00\x00WAVEfmt ", 16)) == ASU_FORMAT_WAV);
+    assert(probe(bytes("RF64\xff\xff\xff\xffWAVEds64", 16)) == ASU_FORMAT_WAV);
+    assert(probe(bytes("FORM\x00\x00\x10\x00" "AIFFCOMM", 16)) == ASU_FORMAT_AIFF);
+    assert(probe(bytes("FORM\x00\x00\x10\x00" "AIFCFVER", 16)) == ASU_FORMAT_AIFF);
+    assert(probe(bytes("OggS\x00\x02", 6)) == ASU_FORMAT_OGG);
+    // a RIFF that is not audio
+    assert(probe(bytes("RIFF\x24\x00\x00\x00" "AVI LIST", 16)) == ASU_FORMAT_UNKNOWN);
+    // too short to tell
+    assert(probe(bytes("RIF", 3)) == ASU_FORMAT_UNKNOWN);
+    assert(probe(std::vector<unsigned char>()) == ASU_FORMAT_UNKNOWN);
+  }
+
+  #pragma mark Test frame syncs
+  {
+    // ADTS, MPEG-4, 44.1kHz
+    assert(probe(bytes("\xff\xf1\x50\x80\x00\x1f", 6)) == ASU_FORMAT_AAC);
+    // MPEG-1 layer III, 128kbps, 44.1kHz
+    assert(probe(bytes("\xff\xfb\x90\x64", 4)) == ASU_FORMAT_MP3);
+    // free bitrate is fine, the reserved bitrate and sampling rate are not
+    assert(probe(bytes("\xff\xfb\xf0\x64", 4)) == ASU_FORMAT_UNKNOWN);
+    assert(probe(bytes("\xff\xfb\x9c\x64", 4)) == ASU_FORMAT_UNKNOWN);
+    // raw samples starting with 0xff
+    assert(probe(bytes("\xff\x00\x12\x34", 4)) == ASU_FORMAT_UNKNOWN);
+  }
+
+  #pragma mark Test ID3 tags
+  {
+    std::vector<unsigned char> tagged = bytes("ID3\x04\x00\x00\x00\x00\x00\x14", 10);
+    tagged.resize(30, 0);
+    assert(id3TagSize(tagged.data(), tagged.size()) == 30);
+    std::vector<unsigned char> mp3 = tagged;
+    mp3.insert(mp3.end(), { 0xff, 0xfb, 0x90, 0x64 });
+    assert(probe(mp3) == ASU_FORMAT_MP3);
+    std::vector<unsigned char> aac = tagged;
+    aac.insert(aac.end(), { 0xff, 0xf1, 0x50, 0x80 });
+    assert(probe(aac) == ASU_FORMAT_AAC);
+    // the frames are past the bytes that have been read
+    std::vector<unsigned char> big = bytes("ID3\x03\x00\x00\x00\x01\x00\x00", 10);
+    assert(id3TagSize(big.data(), big.size()) == 16384 + 10);
+    assert(probe(big) == ASU_FORMAT_MP3);
+    assert(id3TagSize(mp3.data() + 30, 4) == 0);
+  }
+
+  #pragma mark Test the extension against the content
+  {
+    // a headerless file starting with two -1 int16 samples looks like mp3
+    std::vector<unsigned char> silence = bytes("\xff\xff\x00\x00\xff\xff\x01\x00", 8);
+    assert(probe(silence) == ASU_FORMAT_MP3 && !hasAudioFormatMagic(silence.data(), silence.size()));
+    assert(probeAudioFormat(silence.data(), silence.size(), ASU_FORMAT_RAW) == ASU_FORMAT_RAW);
+    assert(probeAudioFormat(silence.data(), silence.size(), ASU_FORMAT_UNKNOWN) == ASU_FORMAT_MP3);
+    std::vector<unsigned char> adts = bytes("\xff\xf1\x50\x80\x00\x1f", 6);
+    assert(probeAudioFormat(adts.data(), adts.size(), ASU_FORMAT_MP3) == ASU_FORMAT_MP3);
+    // magics win over the extension
+    std::vector<unsigned char> wav = bytes("RIFF\x24\x00\x00\x00WAVEfmt ", 16);
+    assert(probeAudioFormat(wav.data(), wav.size(), ASU_FORMAT_RAW) == ASU_FORMAT_WAV);
+    std::vector<unsigned char> ogg = bytes("OggS\x00\x02", 6);
+    assert(probeAudioFormat(ogg.data(), ogg.size(), ASU_FORMAT_MP3) == ASU_FORMAT_OGG);
+    std::vector<unsigned char> tagged = bytes("ID3\x04\x00\x00\x00\x00\x00\x00", 10);
+    tagged.insert(tagged.end(), { 0xff, 0xfb, 0x90, 0x64 });
+    assert(probeAudioFormat(tagged.data(), tagged.size(), ASU_FORMAT_WAV) == ASU_FORMAT_MP3);
+    // nothing recognized
+    std::vector<unsigned char> zeros(16, 0);
+    assert(probeAudioFormat(zeros.data(), zeros.size(), ASU_FORMAT_RAW) == ASU_FORMAT_RAW);
+  }
+
+  return 0;
+}
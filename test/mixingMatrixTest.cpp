@@ -0,0 +1,94 @@
+#include <iostream>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+#define N 5000
+
+static bool near(float a, float b) {
+  return fabs(a - b) < 1e-5F;
+}
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test presets agree with sum and convertToMono
+  {
+    AudioBuffer mono(1, N);
+    mono.createNoise(-1.0F, 1.0F);
+
+    AudioBuffer stereo1(2, N), stereo2(2, N);
+    stereo1.fill(0.1F, N);
+    stereo2 = stereo1;
+    stereo1.sum(mono, N);
+    stereo2.sum(mono, MixingMatrix::monoToStereo(), N);
+    for (size_t ch = 0; ch < 2; ++ch) {
+      assert(std::equal(stereo1.data[ch], stereo1.data[ch] + N, stereo2.data[ch]));
+    }
+
+    AudioBuffer down(1, N);
+    down.sum(stereo1, MixingMatrix::stereoToMono(), N);
+    stereo1.convertToMono();
+    for (size_t i = 0; i < N; ++i) {
+      assert(near(down.data[0][i], stereo1.data[0][i]));
+    }
+  }
+
+  #pragma mark Test 5.1 downmix
+  {
+    AudioBuffer surround(6, N);
+    for (size_t ch = 0; ch < 6; ++ch) {
+      std::fill(surround.data[ch], surround.data[ch] + N, (float)(ch + 1));
+    }
+    surround.markAsWritten();
+    AudioBuffer out(2, N);
+    out.sum(surround, MixingMatrix::surround51ToStereo(), N);
+    const float g = 0.70710678F;
+    assert(near(out.data[0][N - 1], 1.F + 3.F * g + 5.F * g));
+    assert(near(out.data[1][N - 1], 2.F + 3.F * g + 6.F * g));
+  }
+
+  #pragma mark Test ambisonics decode and expansion
+  {
+    // a plane wave from the left: W = 1, Y = 1, Z = X = 0
+    AudioBuffer foa(4, N);
+    foa.fill(0.F, N);
+    std::fill(foa.data[0], foa.data[0] + N, 1.F);
+    std::fill(foa.data[1], foa.data[1] + N, 1.F);
+    foa.markAsWritten(0);
+    foa.markAsWritten(1);
+    MixingMatrix decoder = MixingMatrix::ambisonicsToStereo();
+    assert(decoder.getRoutes(0).size() == 2);
+
+    // a mono buffer with room for two channels is expanded by the mix
+    AudioBuffer out(2, N);
+    out.setUsedChannels(1);
+    out.fill(0.5F, N);
+    out.sum(foa, decoder, N);
+    assert(out.usedChannels == 2);
+    assert(near(out.data[0][10], 1.5F));
+    assert(near(out.data[1][10], 0.F));
+  }
+
+  #pragma mark Test generic matrix
+  {
+    AudioBuffer in(3, N);
+    in.createNoise(-1.0F, 1.0F);
+    MixingMatrix matrix(3, 3);
+    for (size_t o = 0; o < 3; ++o) {
+      for (size_t i = 0; i < 3; ++i) {
+        matrix.setGain(o, i, (o == i) ? 0.F : 0.25F * (float)(o + i));
+      }
+    }
+    AudioBuffer out(3, N);
+    out.sum(in, matrix, N);
+    for (size_t o = 0; o < 3; ++o) {
+      for (size_t n = 0; n < N; ++n) {
+        float expected = 0.F;
+        for (size_t i = 0; i < 3; ++i) expected += in.data[i][n] * matrix.getGain(o, i);
+        assert(near(out.data[o][n], expected));
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <chrono>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+#define N 100003
+
+static void moments(const float* x, size_t n, double& mean, double& variance) {
+  mean = 0;
+  for (size_t i = 0; i < n; ++i) mean += x[i];
+  mean /= n;
+  variance = 0;
+  for (size_t i = 0; i < n; ++i) variance += (x[i] - mean) * (x[i] - mean);
+  variance /= n;
+}
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test uniform noise
+  {
+    AudioBuffer buffer(2, N);
+    buffer.createNoise(-0.5F, 1.5F, 7);
+    for (size_t ch = 0; ch < 2; ++ch) {
+      double mean, variance;
+      moments(buffer[ch], N, mean, variance);
+      assert(fabs(mean - 0.5) < 0.01 && fabs(variance - 4. / 12.) < 0.01);
+      assert(*std::min_element(buffer[ch], buffer[ch] + N) >= -0.5F);
+      assert(*std::max_element(buffer[ch], buffer[ch] + N) <= 1.5F);
+    }
+    // the channels are independent streams
+    double correlation = 0;
+    for (size_t i = 0; i < N; ++i) correlation += (buffer[0][i] - 0.5) * (buffer[1][i] - 0.5);
+    assert(fabs(correlation / N) < 0.01);
+  }
+
+  #pragma mark Test seeds
+  {
+    AudioBuffer a(1, N), b(1, N), c(1, N);
+    a.createNoise(-1.F, 1.F, 42);
+    b.createNoise(-1.F, 1.F, 42);
+    c.createNoise(-1.F, 1.F, 43);
+    assert(std::equal(a[0], a[0] + N, b[0]));
+    assert(!std::equal(a[0], a[0] + N, c[0]));
+    // without a seed every call is different
+    a.createNoise(-1.F, 1.F);
+    b.createNoise(-1.F, 1.F);
+    assert(!std::equal(a[0], a[0] + N, b[0]));
+
+    // the samples don't depend on how the calls are split
+    std::vector<float> whole(1000), split(1000);
+    NoiseGenerator(5, 3).uniform(&whole[0], 1000, -1.F, 1.F);
+    NoiseGenerator generator(5, 3);
+    size_t done = 0, step = 1;
+    while (done < 1000) {
+      size_t count = std::min(step, 1000 - done);
+      generator.uniform(&split[done], count, -1.F, 1.F);
+      done += count;
+      step = step * 2 + 1;
+    }
+    assert(whole == split);
+  }
+
+  #pragma mark Test gaussian noise
+  {
+    AudioBuffer buffer(1, N);
+    buffer.createGaussianNoise(0.25F, 2.F, 1);
+    double mean, variance;
+    moments(buffer[0], N, mean, variance);
+    assert(fabs(mean - 0.25) < 0.03 && fabs(sqrt(variance) - 2.) < 0.03);
+    // odd lengths keep the pairs of the transform
+    std::vector<double> whole(11), split(11);
+    NoiseGenerator(9).gaussian(&whole[0], 11, 0., 1.);
+    NoiseGenerator generator(9);
+    generator.gaussian(&split[0], 3, 0., 1.);
+    generator.gaussian(&split[3], 8, 0., 1.);
+    for (size_t i = 0; i < 11; ++i) {
+      assert(fabs(whole[i] - split[i]) < 1e-6);
+    }
+  }
+
+  #pragma mark Test pink noise falls by 3 dB per octave
+  {
+    const size_t n = 1 << 20;
+    AudioBuffer buffer(1, n);
+    buffer.createPinkNoise(1.F, 3);
+    // energy of the difference is dominated by the high end, of the signal by the low end
+    double energy = 0, lowBand = 0, highBand = 0;
+    float smooth = 0;
+    for (size_t i = 1; i < n; ++i) {
+      energy += buffer[0][i] * buffer[0][i];
+      smooth += (buffer[0][i] - smooth) * 0.01F;
+      lowBand += smooth * smooth;
+      highBand += (buffer[0][i] - buffer[0][i - 1]) * (buffer[0][i] - buffer[0][i - 1]);
+    }
+    AudioBuffer white(1, n);
+    white.createNoise(-1.F, 1.F, 3);
+    double whiteLow = 0, whiteHigh = 0;
+    smooth = 0;
+    for (size_t i = 1; i < n; ++i) {
+      smooth += (white[0][i] - smooth) * 0.01F;
+      whiteLow += smooth * smooth;
+      whiteHigh += (white[0][i] - white[0][i - 1]) * (white[0][i] - white[0][i - 1]);
+    }
+    // compared with white noise, pink has more in the lows than in the highs
+    assert(lowBand / highBand > 10 * whiteLow / whiteHigh);
+    assert(energy / n > 0.01 && energy / n < 1.);
+  }
+
+  #pragma mark Test the samples past usedSize keep the constant value
+  {
+    AudioBuffer buffer(2, 100);
+    buffer.setIsConstant(true, .25F);
+    buffer.usedSize = 50;
+    buffer.createNoise(-1.F, 1.F, 5);
+    buffer.createGaussianNoise(0.F, 1.F, 5);
+    buffer.createPinkNoise(1.F, 5);
+    for (size_t ch = 0; ch < 2; ++ch) {
+      assert(!buffer.channelIsConstant[ch]);
+      for (size_t i = 50; i < 100; ++i) {
+        assert(buffer.data[ch][i] == .25F);
+      }
+    }
+  }
+
+  #pragma mark Time an hour of stereo noise
+  {
+    AudioBuffer buffer(2, 48000 * 600);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 6; ++i) {
+      buffer.createNoise(-1.F, 1.F);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cerr << "1 hour of uniform stereo noise at 48 kHz: " << elapsed.count() << " ms" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <chrono>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test addSine matches sin
+  {
+    const size_t n = 1 << 20;
+    const double rate = 48000;
+    const float frequencies[] = { 0.F, 1.F, 440.F, 997.F, 23999.F };
+    for (float frequency : frequencies) {
+      AudioBuffer buffer(2, n);
+      buffer.fill(0.25F, n);
+      buffer.addSine(frequency, rate, 0.5F);
+      double error = 0;
+      for (size_t ch = 0; ch < 2; ++ch) {
+        for (size_t i = 0; i < n; ++i) {
+          double expected = 0.25 + 0.5 * sin(2 * M_PI * frequency * (double)i / rate);
+          error = std::max(error, fabs(buffer[ch][i] - expected));
+        }
+      }
+      assert(error < 2e-6);
+    }
+  }
+
+  #pragma mark Test partials are summed and keep their phase across calls
+  {
+    const double rate = 44100;
+    OscillatorBankC<double> bank(rate);
+    bank.addPartial(100, 0.5);
+    bank.addPartial(300, 0.25, M_PI / 2);
+    size_t third = bank.addPartial(1234.5, 0.125, 1.);
+    assert(bank.getNumberOfPartials() == 3);
+    std::vector<double> out(5000, 0.);
+    // odd lengths, so the blocks never line up with the calls
+    bank.addTo(&out[0], 1001);
+    bank.addTo(&out[1001], 3999);
+    for (size_t i = 0; i < out.size(); ++i) {
+      double t = 2 * M_PI * i / rate;
+      double expected = 0.5 * sin(100 * t) + 0.25 * cos(300 * t) + 0.125 * sin(1234.5 * t + 1.);
+      assert(fabs(out[i] - expected) < 1e-9);
+    }
+
+    // changing the frequency doesn't make the phase jump
+    bank.reset();
+    bank.clear();
+    third = bank.addPartial(1000);
+    std::vector<double> sweep(2000, 0.);
+    bank.addTo(&sweep[0], 1000);
+    bank.setFrequency(third, 2000);
+    bank.addTo(&sweep[1000], 1000);
+    double phaseAt1000 = 2 * M_PI * 1000 * 1000 / rate;
+    for (size_t i = 1000; i < sweep.size(); ++i) {
+      assert(fabs(sweep[i] - sin(phaseAt1000 + 2 * M_PI * 2000 * (i - 1000) / rate)) < 1e-9);
+    }
+  }
+
+  #pragma mark Time a test tone and a harmonic series
+  {
+    const size_t n = 48000 * 60;
+    AudioBuffer buffer(8, n);
+    buffer.fill(0.F, n);
+    auto start = std::chrono::high_resolution_clock::now();
+    buffer.addSine(1000.F, 48000.F);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cerr << "60 s of 1 kHz on 8 channels: " << elapsed.count() << " ms" << std::endl;
+
+    OscillatorBank bank(48000);
+    for (int h = 1; h <= 32; ++h) {
+      bank.addPartial(110. * h, 1. / h);
+    }
+    start = std::chrono::high_resolution_clock::now();
+    buffer.addOscillators(bank);
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cerr << "60 s of 32 partials on 8 channels: " << elapsed.count() << " ms" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <chrono>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+static void fillSine(AudioBuffer& buffer, double frequency, double rate) {
+  for (size_t ch = 0; ch < buffer.channels; ++ch) {
+    for (size_t i = 0; i < buffer.size; ++i) {
+      buffer[ch][i] = (float)(0.5 * sin(2 * M_PI * frequency * i / rate + ch));
+    }
+  }
+}
+
+// largest distance from the ideal sine, away from the edges
+static double sineError(AudioBuffer& buffer, double frequency, double rate) {
+  double error = 0;
+  for (size_t ch = 0; ch < buffer.channels; ++ch) {
+    for (size_t i = 200; i + 200 < buffer.size; ++i) {
+      error = std::max(error, fabs(buffer[ch][i] - 0.5 * sin(2 * M_PI * frequency * i / rate + ch)));
+    }
+  }
+  return error;
+}
+
+int main (int argc, char** argv) {
+
+  #pragma mark Test common ratios keep a sine in place
+  {
+    const float rates[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 48000, 96000 }, { 96000, 48000 },
+      { 22050, 88200 }, { 192000, 48000 }, { 44100, 44101 } };
+    for (auto& pair : rates) {
+      AudioBuffer buffer(2, 9000);
+      fillSine(buffer, 1000, pair[0]);
+      float* before = buffer.data[0];
+      assert(buffer.resample(pair[0], pair[1]));
+      assert(buffer.size == (size_t)ceil(9000. * pair[1] / pair[0]) && buffer.usedSize == buffer.size);
+      // going down the samples stay where they were
+      assert(pair[1] > pair[0] || buffer.data[0] == before);
+      assert(sineError(buffer, 1000, pair[1]) < 1e-3);
+    }
+  }
+
+  #pragma mark Test the qualities
+  {
+    for (int quality = ASU_RESAMPLER_FAST; quality <= ASU_RESAMPLER_BEST; ++quality) {
+      AudioBuffer buffer(1, 20000);
+      fillSine(buffer, 5000, 44100);
+      assert(buffer.resample(44100, 48000, (ResamplerQuality)quality));
+      double error = sineError(buffer, 5000, 48000);
+      assert(error < (quality == ASU_RESAMPLER_FAST ? 1e-2 : 1e-3));
+    }
+  }
+
+  #pragma mark Test what is above the new Nyquist frequency is removed
+  {
+    AudioBuffer buffer(1, 48000);
+    fillSine(buffer, 30000, 96000);
+    assert(buffer.resample(96000, 48000));
+    assert(sineError(buffer, 0, 48000) < 1e-3 * 0.5);
+  }
+
+  #pragma mark Test streaming in odd blocks gives the one-shot result
+  {
+    AudioBuffer input(2, 10007);
+    input.createNoise(-1.F, 1.F);
+    AudioBuffer oneShot(input);
+    assert(oneShot.resample(44100, 48000));
+
+    Resampler resampler;
+    assert(resampler.init(44100, 48000, 2));
+    AudioBuffer streamed(2, resampler.getOutputLength(input.size));
+    assert(streamed.size == oneShot.size);
+    size_t read = 0, written = 0, block = 1;
+    while (read < input.size) {
+      size_t count = std::min(block, input.size - read);
+      // the output is given less room than it needs, the rest waits
+      written += resampler.process(input.getConstView(read, count), streamed.getView(written, std::min(block / 2 + 1, streamed.size - written)));
+      read += count;
+      block = block * 3 % 1000 + 1;
+    }
+    size_t count;
+    while ((count = resampler.flush(streamed.getView(written, std::min((size_t)64, streamed.size - written)))) > 0) {
+      written += count;
+    }
+    assert(written == streamed.size);
+    for (size_t ch = 0; ch < 2; ++ch) {
+      for (size_t i = 0; i < streamed.size; ++i) {
+        assert(streamed[ch][i] == oneShot[ch][i]);
+      }
+    }
+  }
+
+  #pragma mark Test constant channels and bad rates
+  {
+    AudioBuffer buffer(2, 1000);
+    fillSine(buffer, 440, 44100);
+    buffer.setChannelIsConstant(1, true, 0.25F);
+    assert(buffer.resample(44100, 48000));
+    assert(buffer.channelIsConstant[1] && buffer[1][buffer.size - 1] == 0.25F);
+    assert(!buffer.resample(0, 48000) && !buffer.resample(48000, -1));
+    size_t size = buffer.size;
+    assert(buffer.resample(48000, 48000) && buffer.size == size);
+  }
+
+  #pragma mark Time a minute of stereo from 44.1 to 48 kHz
+  {
+    AudioBuffer buffer(2, 44100 * 60);
+    buffer.createNoise(-1.F, 1.F);
+    auto start = std::chrono::high_resolution_clock::now();
+    buffer.resample(44100, 48000);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cerr << "60 s stereo 44.1 -> 48 kHz: " << elapsed.count() << " ms" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include "AudioBuffer.hpp"
+#include "SampleConversion.h"
+
+using namespace asu;
+
+#define MAX_CHANNELS 9
+#define N 1027
+
+int main (int argc, char** argv) {
+  std::cerr << "conversions: " << conversion::table().name << std::endl;
+  // the vector conversions follow the CPU check of the kernels
+  assert(kernels::hasSse2() == (strcmp(conversion::table().name, "sse2") == 0));
+
+  AudioBuffer planar(MAX_CHANNELS, N);
+  planar.createNoise(-1.2F, 1.2F);
+  // exact values at the ends of the range
+  planar[0][0] = 1.F;
+  planar[0][1] = -1.F;
+  planar[0][2] = 0.F;
+
+  #pragma mark Test the dispatched conversions match the scalar ones
+  {
+    // the last lengths span more than one block of the two pass conversions
+    const size_t lengths[] = { 0, 1, 3, 7, 15, 31, 500, N };
+    for (unsigned int channels = 1; channels <= MAX_CHANNELS; ++channels) {
+      for (size_t frames : lengths) {
+        std::vector<float> interleaved(frames * channels), reference(frames * channels);
+        conversion::interleave((const float* const*)planar.data, interleaved.data(), channels, frames);
+        conversion::scalar::interleave((const float* const*)planar.data, reference.data(), channels, frames);
+        assert(interleaved == reference);
+
+        std::vector<int16_t> shorts(frames * channels), shortsReference(frames * channels);
+        conversion::interleave((const float* const*)planar.data, shorts.data(), channels, frames);
+        conversion::scalar::interleave((const float* const*)planar.data, shortsReference.data(), channels, frames);
+        assert(shorts == shortsReference);
+
+        AudioBuffer out(channels, N), outReference(channels, N);
+        conversion::deinterleave(shorts.data(), out.getView().getChannelPointers(), channels, frames);
+        conversion::scalar::deinterleave(shorts.data(), outReference.getView().getChannelPointers(), channels, frames);
+        for (size_t ch = 0; ch < channels; ++ch) {
+          assert(std::equal(out[ch], out[ch] + frames, outReference[ch]));
+        }
+        conversion::deinterleave(interleaved.data(), out.getView().getChannelPointers(), channels, frames);
+        for (size_t ch = 0; ch < channels; ++ch) {
+          assert(std::equal(out[ch], out[ch] + frames, planar[ch]));
+        }
+
+        std::vector<int32_t> ints(frames * channels), intsReference(frames * channels);
+        conversion::interleave((const float* const*)planar.data, ints.data(), channels, frames);
+        conversion::scalar::interleave((const float* const*)planar.data, intsReference.data(), channels, frames);
+        assert(ints == intsReference);
+        conversion::deinterleave(ints.data(), out.getView().getChannelPointers(), channels, frames);
+        conversion::scalar::deinterleave(ints.data(), outReference.getView().getChannelPointers(), channels, frames);
+        for (size_t ch = 0; ch < channels; ++ch) {
+          assert(std::equal(out[ch], out[ch] + frames, outReference[ch]));
+        }
+
+        conversion::interleaveInt24((const float* const*)planar.data, ints.data(), channels, frames);
+        conversion::scalar::interleaveInt24((const float* const*)planar.data, intsReference.data(), channels, frames);
+        assert(ints == intsReference);
+
+        std::vector<unsigned char> packed(frames * channels * 3), packedReference(frames * channels * 3);
+        conversion::interleaveInt24((const float* const*)planar.data, packed.data(), channels, frames);
+        conversion::scalar::interleaveInt24((const float* const*)planar.data, packedReference.data(), channels, frames);
+        assert(packed == packedReference);
+        conversion::deinterleaveInt24(packed.data(), out.getView().getChannelPointers(), channels, frames);
+        conversion::scalar::deinterleaveInt24(packed.data(), outReference.getView().getChannelPointers(), channels, frames);
+        for (size_t ch = 0; ch < channels; ++ch) {
+          assert(std::equal(out[ch], out[ch] + frames, outReference[ch]));
+        }
+      }
+    }
+  }
+
+  #pragma mark Test integer round trips
+  {
+    const unsigned int channels = 3;
+    std::vector<int16_t> shorts(N * channels);
+    std::vector<int32_t> ints(N * channels);
+    std::vector<unsigned char> packed(N * channels * 3);
+    conversion::interleave((const float* const*)planar.data, &shorts[0], channels, N);
+    conversion::interleave((const float* const*)planar.data, &ints[0], channels, N);
+    conversion::interleaveInt24((const float* const*)planar.data, &packed[0], channels, N);
+    std::vector<int32_t> words(N * channels);
+    conversion::interleaveInt24((const float* const*)planar.data, &words[0], channels, N);
+    for (size_t i = 0; i < words.size(); ++i) {
+      int32_t fromBytes = (int32_t)(((uint32_t)packed[i * 3 + 2] << 24) | (packed[i * 3 + 1] << 16) | (packed[i * 3] << 8));
+      assert(words[i] == fromBytes);
+    }
+    // full scale, clipped
+    assert(shorts[0] == 32767 && shorts[channels] == -32767 && shorts[2 * channels] == 0);
+    assert(ints[0] == 2147483647 && ints[channels] == -2147483647);
+
+    AudioBuffer out16(channels, N), out24(channels, N), out32(channels, N);
+    conversion::deinterleave(&shorts[0], out16.getView().getChannelPointers(), channels, N);
+    conversion::deinterleaveInt24(&packed[0], out24.getView().getChannelPointers(), channels, N);
+    conversion::deinterleave(&ints[0], out32.getView().getChannelPointers(), channels, N);
+    for (size_t ch = 0; ch < channels; ++ch) {
+      for (size_t i = 0; i < N; ++i) {
+        float expected = std::min(1.F, std::max(-1.F, planar[ch][i]));
+        // written with 2^(bits - 1) - 1 steps and read with 2^(bits - 1)
+        assert(fabs(out16[ch][i] - expected) <= 2.F / 32767.F);
+        assert(fabs(out24[ch][i] - expected) <= 2.F / 8388607.F);
+        assert(fabs(out32[ch][i] - expected) <= 1e-6F);
+      }
+    }
+  }
+
+  #pragma mark Test dither
+  {
+    // a signal below one bit is lost without dither, but survives on average with it
+    const size_t frames = 1 << 16;
+    std::vector<float> tiny(frames, 0.3F / 32767.F);
+    const float* channels[1] = { &tiny[0] };
+    std::vector<int16_t> plain(frames), dithered(frames);
+    conversion::interleave(channels, &plain[0], 1, frames);
+    conversion::TpdfDither dither;
+    conversion::interleave(channels, &dithered[0], 1, frames, &dither);
+    double plainMean = 0, ditheredMean = 0;
+    for (size_t i = 0; i < frames; ++i) {
+      plainMean += plain[i];
+      ditheredMean += dithered[i];
+      assert(abs(dithered[i]) <= 2);
+    }
+    assert(plainMean == 0);
+    ditheredMean /= frames;
+    assert(fabs(ditheredMean - 0.3) < 0.02);
+  }
+
+  #pragma mark Time stereo 16 bit conversions
+  {
+    const size_t frames = 1 << 20;
+    AudioBuffer stereo(2, frames);
+    stereo.createNoise(-1.F, 1.F);
+    std::vector<int16_t> shorts(frames * 2);
+    for (int dispatched = 0; dispatched < 2; ++dispatched) {
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < 20; ++i) {
+        if (dispatched) {
+          conversion::interleave((const float* const*)stereo.data, &shorts[0], 2, frames);
+          conversion::deinterleave(&shorts[0], stereo.data, 2, frames);
+        } else {
+          conversion::scalar::interleave((const float* const*)stereo.data, &shorts[0], 2, frames);
+          conversion::scalar::deinterleave(&shorts[0], stereo.data, 2, frames);
+        }
+      }
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+      std::cerr << (dispatched ? conversion::table().name : "scalar") << ": " << elapsed.count() << " ms" << std::endl;
+    }
+  }
+
+  #pragma mark Time stereo 24 bit conversions
+  {
+    const size_t frames = 1 << 20;
+    AudioBuffer stereo(2, frames);
+    stereo.createNoise(-1.F, 1.F);
+    std::vector<unsigned char> packed(frames * 2 * 3);
+    for (int dispatched = 0; dispatched < 2; ++dispatched) {
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < 20; ++i) {
+        if (dispatched) {
+          conversion::interleaveInt24((const float* const*)stereo.data, &packed[0], 2, frames);
+          conversion::deinterleaveInt24(&packed[0], stereo.data, 2, frames);
+        } else {
+          conversion::scalar::interleaveInt24((const float* const*)stereo.data, &packed[0], 2, frames);
+          conversion::scalar::deinterleaveInt24(&packed[0], stereo.data, 2, frames);
+        }
+      }
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+      std::cerr << "24 bit " << (dispatched ? conversion::table().name : "scalar") << ": " << elapsed.count() << " ms" << std::endl;
+    }
+  }
+
+  #pragma mark Time 8 channel float conversions
+  {
+    const size_t frames = 1 << 17;
+    AudioBuffer stems(8, frames);
+    stems.createNoise(-1.F, 1.F);
+    std::vector<float> interleaved(frames * 8);
+    for (int dispatched = 0; dispatched < 2; ++dispatched) {
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < 20; ++i) {
+        if (dispatched) {
+          conversion::interleave((const float* const*)stems.data, &interleaved[0], 8, frames);
+          conversion::deinterleave(&interleaved[0], stems.data, 8, frames);
+        } else {
+          conversion::scalar::interleave((const float* const*)stems.data, &interleaved[0], 8, frames);
+          conversion::scalar::deinterleave(&interleaved[0], stems.data, 8, frames);
+        }
+      }
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+      std::cerr << "8 channels " << (dispatched ? conversion::table().name : "scalar") << ": " << elapsed.count() << " ms" << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include "AudioBuffer.hpp"
+
+using namespace asu;
+
+#define N 100003
+
+// the dispatched kernels must agree with the scalar versions
+int main (int argc, char** argv) {
+  std::cerr << "Kernels: " << kernels::table().name << std::endl;
+
+  AudioBuffer a(2, N);
+  AudioBuffer b(2, N);
+  a.createNoise(-1.0F, 1.0F);
+  b.createNoise(-0.5F, 0.5F);
+  std::vector<float> expected(N), actual(N);
+
+  #pragma mark Test elementwise kernels against scalar
+  {
+    // odd lengths and offsets exercise the tails and the unaligned loads
+    for (size_t offset = 0; offset < 3; ++offset) {
+      const size_t n = N - offset;
+      std::copy(a.data[0] + offset, a.data[0] + N, expected.begin());
+      std::copy(a.data[0] + offset, a.data[0] + N, actual.begin());
+      kernels::scalar::addScaled(expected.data(), b.data[1], n, 0.3F);
+      kernels::addScaled(actual.data(), b.data[1], n, 0.3F);
+      assert(expected == actual);
+
+      kernels::scalar::addAndScale(expected.data(), b.data[0], n, 0.5F);
+      kernels::addAndScale(actual.data(), b.data[0], n, 0.5F);
+      assert(expected == actual);
+
+      kernels::scalar::add(expected.data(), a.data[1], b.data[1] + offset, n);
+      kernels::add(actual.data(), a.data[1], b.data[1] + offset, n);
+      assert(expected == actual);
+
+      kernels::scalar::scale(expected.data(), n, -2.0F);
+      kernels::scale(actual.data(), n, -2.0F);
+      assert(expected == actual);
+
+      kernels::scalar::offset(expected.data(), n, 0.25F);
+      kernels::offset(actual.data(), n, 0.25F);
+      assert(expected == actual);
+    }
+  }
+
+  #pragma mark Test reductions
+  {
+    float lo, hi, loRef, hiRef;
+    kernels::minMax(a.data[0] + 1, N - 1, &lo, &hi);
+    kernels::scalar::minMax(a.data[0] + 1, N - 1, &loRef, &hiRef);
+    assert(lo == loRef && hi == hiRef);
+    kernels::minMax(a.data[0], 0, &lo, &hi);
+    assert(lo == 0.F && hi == 0.F);
+
+    double total = kernels::sum(a.data[1], N);
+    double totalRef = kernels::scalar::sum(a.data[1], N);
+    assert(fabs(total - totalRef) < 1e-9);
+
+    for (size_t n = 0; n < 40; ++n) {
+      double product = kernels::dot(a.data[0] + 1, a.data[1], n);
+      double productRef = kernels::scalar::dot(a.data[0] + 1, a.data[1], n);
+      assert(fabs(product - productRef) < 1e-4);
+    }
+  }
+
+  #pragma mark Test statistics
+  {
+    std::vector<float> x(a.data[0], a.data[0] + N);
+    // a negative peak, reached twice, and a few clipped samples
+    x[777] = -1.5F;
+    x[50001] = 1.5F;
+    x[90000] = 1.25F;
+    for (size_t offset = 0; offset < 9; ++offset) {
+      for (size_t n = 0; n < 40; n = n * 2 + 1) {
+        kernels::Statistics stats, ref;
+        kernels::statistics(&x[offset], n, 0.9F, &stats);
+        kernels::scalar::statistics(&x[offset], n, 0.9F, &ref);
+        assert(stats.length == n && stats.min == ref.min && stats.max == ref.max);
+        assert(stats.peak == ref.peak && stats.peakIndex == ref.peakIndex && stats.clipped == ref.clipped);
+        assert(fabs(stats.sum - ref.sum) < 1e-4 && fabs(stats.sumOfSquares - ref.sumOfSquares) < 1e-4);
+      }
+    }
+    kernels::Statistics stats, ref;
+    kernels::statistics(&x[0], N, 1.F, &stats);
+    kernels::scalar::statistics(&x[0], N, 1.F, &ref);
+    assert(stats.min == -1.5F && stats.max == 1.5F && stats.peak == 1.5F && stats.peakIndex == 777);
+    assert(stats.clipped == 3 && ref.clipped == 3);
+    assert(fabs(stats.sum - ref.sum) < 1e-2 && fabs(stats.sumOfSquares - ref.sumOfSquares) < 1e-2);
+    // appending the statistics of two halves gives those of the whole
+    kernels::Statistics first, second;
+    kernels::statistics(&x[0], 60000, 1.F, &first);
+    kernels::statistics(&x[60000], N - 60000, 1.F, &second);
+    first.append(second);
+    assert(first.length == N && first.peakIndex == 777 && first.clipped == 3);
+    assert(fabs(first.sum - stats.sum) < 1e-2);
+  }
+
+  #pragma mark Test AudioBuffer methods
+  {
+    AudioBuffer c(a);
+    c.sumWithGain(b, N, 0.5F);
+    for (size_t i = 0; i < N; ++i) {
+      assert(c.data[1][i] == a.data[1][i] + b.data[1][i] * 0.5F);
+    }
+
+    AudioBuffer mono(a, true);
+    assert(mono.usedChannels == 1);
+    for (size_t i = 0; i < N; ++i) {
+      assert(mono.data[0][i] == (a.data[0][i] + a.data[1][i]) * 0.5F);
+    }
+
+    c = a;
+    c.fill(3.0F, N);
+    c.sum(a, N);
+    c.removeDC();
+    for (size_t ch = 0; ch < 2; ++ch) {
+      assert(fabs(kernels::sum(c.data[ch], N) / N) < 1e-5);
+    }
+
+    c.normalize();
+    assert(fabs(std::max(kernels::peak(c.data[0], N), kernels::peak(c.data[1], N)) - 1.0F) < 1e-6);
+
+    // negative peaks are found too
+    c = a;
+    c.data[1][1234] = -2.F;
+    size_t index;
+    float value;
+    c.findPeak(&index, &value, 1000, 2000);
+    assert(index == 1234 && value == 2.F);
+    c.findPeak(&index, &value, 2000, N);
+    assert(index >= 2000 && value < 1.F);
+
+    std::vector<kernels::Statistics> overview = c.getOverview(1, 1000);
+    assert(overview.size() == (N + 999) / 1000 && overview.back().length == N % 1000);
+    assert(overview[1].min == -2.F && overview[1].peakIndex == 234);
+
+    // constant channels are not written out
+    c.setChannelIsConstant(0, true, -0.5F);
+    kernels::Statistics constant = c.getStatistics(0, 10, 100, 0.5F);
+    assert(c.channelIsConstant[0]);
+    assert(constant.length == 100 && constant.peak == 0.5F && constant.clipped == 100 && constant.mean() == -0.5);
+  }
+
+  #pragma mark Benchmark
+  {
+    AudioBuffer c(a);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 100; ++i) {
+      c.sumWithGain(b, N, 0.99F);
+      c.applyGain(0.5F);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cerr << "100 x (sumWithGain + applyGain) on 2 x " << N << " frames: " << elapsed.count() << " us" << std::endl;
+
+    double total = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 100; ++i) {
+      total += c.getStatistics(0).rms() + c.getStatistics(1).rms();
+    }
+    elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cerr << "100 x statistics on 2 x " << N << " frames: " << elapsed.count() << " us (" << total << ")" << std::endl;
+  }
+
+  return 0;
+}